@@ -0,0 +1,264 @@
+#include "base.hpp"
+
+#include <dlfcn.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+
+static
+u64 alloc_profiler_next_random(AllocProfiler* p){
+	/* xorshift64* */
+	u64 x = p->rng_state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	p->rng_state = x;
+	return x * 0x2545f4914f6cdd1dull;
+}
+
+// Distance to the next sample, exponentially distributed so that sampling
+// behaves like a Poisson process over allocated bytes.
+static
+isize alloc_profiler_next_interval(AllocProfiler* p){
+	f64 u = f64((alloc_profiler_next_random(p) >> 11) + 1) * (1.0 / 9007199254740992.0);
+	isize n = isize(-log(u) * f64(p->sample_period));
+	return max(n, isize(1));
+}
+
+static thread_local uintptr stack_high_address = 0;
+
+static
+uintptr current_stack_high(){
+	[[unlikely]] if(stack_high_address == 0){
+		pthread_attr_t attr;
+		void* addr = nullptr;
+		size_t size = 0;
+		if(pthread_getattr_np(pthread_self(), &attr) == 0){
+			pthread_attr_getstack(&attr, &addr, &size);
+			pthread_attr_destroy(&attr);
+		}
+		stack_high_address = (uintptr)addr + size;
+	}
+	return stack_high_address;
+}
+
+__attribute__((noinline))
+static
+i32 capture_stack(uintptr* frames, i32 max_depth, i32 skip){
+	uintptr high = current_stack_high();
+	uintptr fp = (uintptr)__builtin_frame_address(0);
+	i32 depth = 0;
+
+	while(depth < max_depth){
+		if(fp == 0 || (fp & (sizeof(uintptr) - 1)) != 0 || fp + 2 * sizeof(uintptr) > high){ break; }
+
+		uintptr next = ((uintptr*)fp)[0];
+		uintptr ret  = ((uintptr*)fp)[1];
+		if(ret == 0){ break; }
+
+		if(skip > 0){ skip -= 1; }
+		else {
+			frames[depth] = ret;
+			depth += 1;
+		}
+
+		if(next <= fp){ break; } /* Stack grows down, frames must go up */
+		fp = next;
+	}
+	return depth;
+}
+
+static
+u64 hash_frames(uintptr const* frames, i32 depth){
+	u64 h = 0xcbf29ce484222325ull;
+	for(i32 i = 0; i < depth; i += 1){
+		h = (h ^ u64(frames[i])) * 0x100000001b3ull;
+	}
+	return h;
+}
+
+__attribute__((noinline))
+static
+void alloc_profiler_record(AllocProfiler* p, isize size){
+	uintptr frames[alloc_profiler_max_depth];
+	/* Skip alloc_profiler_record, alloc_profiler_account and the allocator function */
+	i32 depth = capture_stack(frames, alloc_profiler_max_depth, 3);
+	if(depth == 0){
+		frames[0] = 0;
+		depth = 1;
+	}
+	u64 h = hash_frames(frames, depth);
+
+	// Unbiased estimate of the bytes this sample stands for
+	f64 period = f64(p->sample_period);
+	f64 weight = f64(size) / -expm1(-f64(size) / period);
+
+	spin_lock(&p->lock);
+	defer(spin_unlock(&p->lock));
+
+	isize n = len(p->stacks);
+	if(n == 0){ return; }
+
+	isize mask = n - 1;
+	for(isize i = isize(h) & mask, probes = 0; probes < n; i = (i + 1) & mask, probes += 1){
+		auto& s = p->stacks[i];
+		if(s.depth == 0){
+			if(p->stack_count * 4 >= n * 3){ break; } /* Keep probe sequences short */
+			s.hash = h;
+			s.depth = depth;
+			mem_copy_no_overlap(s.frames, frames, sizeof(uintptr) * depth);
+			s.count = 1;
+			s.bytes = isize(weight);
+			p->stack_count += 1;
+			return;
+		}
+		if(s.hash == h && s.depth == depth && mem_compare(s.frames, frames, sizeof(uintptr) * depth) == 0){
+			s.count += 1;
+			s.bytes += isize(weight);
+			return;
+		}
+	}
+	p->dropped += 1;
+}
+
+__attribute__((noinline))
+static
+void alloc_profiler_account(AllocProfiler* p, isize size){
+	if(size <= 0){ return; }
+	isize left = p->bytes_until_sample.fetch_sub(size, std::memory_order_relaxed) - size;
+	if(left > 0){ return; }
+
+	// Only the thread crossing zero takes the sample and re-arms the counter
+	if(left + size > 0){
+		spin_lock(&p->lock);
+		isize interval = alloc_profiler_next_interval(p);
+		spin_unlock(&p->lock);
+		p->bytes_until_sample.fetch_add(interval - left, std::memory_order_relaxed);
+		alloc_profiler_record(p, size);
+	}
+}
+
+void alloc_profiler_init(AllocProfiler* p, Allocator parent, isize sample_period, isize max_stacks){
+	ensure(sample_period > 0, "Sample period must be positive");
+	ensure(mem_valid_alignment(max_stacks), "Stack table size must be a power of 2");
+
+	p->parent = parent;
+	p->sample_period = sample_period;
+	p->rng_state = u64((uintptr)p) ^ 0x9e3779b97f4a7c15ull;
+	p->lock._locked.store(false, std::memory_order_relaxed);
+	p->stacks = make<AllocProfilerStack>(max_stacks, parent);
+	p->stack_count = 0;
+	p->dropped = 0;
+	p->bytes_until_sample.store(alloc_profiler_next_interval(p), std::memory_order_relaxed);
+}
+
+void alloc_profiler_destroy(AllocProfiler* p){
+	destroy(p->stacks, p->parent);
+	p->stacks = {};
+	p->stack_count = 0;
+}
+
+void alloc_profiler_reset(AllocProfiler* p){
+	spin_lock(&p->lock);
+	mem_set(raw_data(p->stacks), 0, len(p->stacks) * sizeof(AllocProfilerStack));
+	p->stack_count = 0;
+	p->dropped = 0;
+	spin_unlock(&p->lock);
+}
+
+static
+void append_bytes(DynamicArray<byte>* out, char const* s, isize n){
+	for(isize i = 0; i < n; i += 1){
+		append(out, byte(s[i]));
+	}
+}
+
+static
+void append_frame_name(DynamicArray<byte>* out, uintptr addr){
+	char buf[512];
+	i32 n = 0;
+
+	/* Return addresses point after the call, step back into it */
+	Dl_info info;
+	if(dladdr((void*)(addr - 1), &info) != 0){
+		if(info.dli_sname){
+			n = snprintf(buf, sizeof(buf), "%s", info.dli_sname);
+		}
+		else if(info.dli_fname){
+			char const* file = info.dli_fname;
+			for(char const* c = file; *c; c += 1){
+				if(*c == '/'){ file = c + 1; }
+			}
+			n = snprintf(buf, sizeof(buf), "%s+0x%lx", file, (unsigned long)(addr - (uintptr)info.dli_fbase));
+		}
+	}
+	if(n <= 0){
+		n = snprintf(buf, sizeof(buf), "0x%lx", (unsigned long)addr);
+	}
+
+	n = min(n, i32(sizeof(buf) - 1));
+	/* ';' and ' ' are separators in the collapsed format */
+	for(i32 i = 0; i < n; i += 1){
+		if(buf[i] == ';' || buf[i] == ' '){ buf[i] = '_'; }
+	}
+	append_bytes(out, buf, n);
+}
+
+String alloc_profiler_dump_collapsed(AllocProfiler* p, Allocator out_allocator){
+	auto out = make_dynamic_array<byte>(out_allocator, 4 * mem_KiB);
+
+	spin_lock(&p->lock);
+	defer(spin_unlock(&p->lock));
+
+	for(isize i = 0; i < len(p->stacks); i += 1){
+		auto& s = p->stacks[i];
+		if(s.depth == 0){ continue; }
+
+		for(i32 f = s.depth - 1; f >= 0; f -= 1){
+			append_frame_name(&out, s.frames[f]);
+			if(f > 0){ append(&out, byte(';')); }
+		}
+
+		char num[32];
+		i32 n = snprintf(num, sizeof(num), " %ld\n", (long)s.bytes);
+		append_bytes(&out, num, n);
+	}
+
+	/* Copied out so the result is sized like any other owned String */
+	String result = str_clone(String(out._data, len(out)), out_allocator);
+	destroy(&out);
+	return result;
+}
+
+static
+Result<void*, AllocatorError> alloc_profiler_allocator_func(
+	void* data,
+	AllocatorMode mode,
+	isize size,
+	isize align,
+	void* old_ptr,
+	isize old_size,
+	isize old_align
+){
+	auto p = (AllocProfiler*)data;
+	auto parent = p->parent;
+	auto result = parent.func(parent.data, mode, size, align, old_ptr, old_size, old_align);
+
+	if(ok(result)){
+		if(mode == AllocatorMode::Alloc){
+			alloc_profiler_account(p, size);
+		}
+		else if(mode == AllocatorMode::Realloc){
+			alloc_profiler_account(p, size - old_size);
+		}
+	}
+	return result;
+}
+
+Allocator alloc_profiler_allocator(AllocProfiler* p){
+	Allocator a = {
+		.data = (void*)p,
+		.func = alloc_profiler_allocator_func,
+	};
+	return a;
+}
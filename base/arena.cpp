@@ -4,6 +4,8 @@ void arena_init(Arena* a, Slice<byte> buf){
 	a->data = (void*)raw_data(buf);
 	a->offset = 0;
 	a->capacity = len(buf);
+	a->peak_offset = 0;
+	a->retain_size = -1;
 	a->last_allocation = NULL;
 	a->region_count = 0;
 }
@@ -24,6 +26,7 @@ void* arena_alloc(Arena* a, isize size, isize align){
 	}
 
 	a->offset += required;
+	a->peak_offset = max(a->peak_offset, a->offset);
 	void* allocation = (void*)aligned;
 	a->last_allocation = allocation;
 	mem_set(allocation, 0, size);
@@ -45,16 +48,35 @@ bool arena_resize_in_place(Arena* a, void* ptr, isize size){
 		}
 
 		a->offset += size - last_allocation_size;
+		a->peak_offset = max(a->peak_offset, a->offset);
 		return true;
 	}
 
 	return false;
 }
 
+static
+void arena_decommit_above(Arena* a, isize keep){
+	if(a->retain_size < 0){ return; }
+	keep = max(keep, a->retain_size);
+
+	// Skip the syscall unless at least a whole page can be returned
+	if(a->peak_offset - keep < mem_page_size()){ return; }
+
+	isize end = min(mem_align_forward_size(a->peak_offset, mem_page_size()), a->capacity);
+	mem_decommit((byte*)a->data + keep, end - keep);
+	a->peak_offset = keep;
+}
+
+void arena_set_decommit(Arena* a, isize retain_size){
+	a->retain_size = retain_size;
+}
+
 void arena_free_all(Arena* a){
 	ensure(a->region_count == 0, "Arena has dangling regions");
 	a->offset = 0;
 	a->last_allocation = NULL;
+	arena_decommit_above(a, 0);
 }
 
 ArenaRegion arena_region_begin(Arena* a){
@@ -72,6 +94,7 @@ void arena_region_end(ArenaRegion reg){
 
 	reg.arena->offset = reg.offset;
 	reg.arena->region_count -= 1;
+	arena_decommit_above(reg.arena, reg.offset);
 }
 
 Result<void*, AllocatorError> arena_allocator_func (
@@ -1,10 +1,22 @@
 #include "base.hpp"
 
 #include "assert.cpp"
+#include "sync.cpp"
+#include "thread_pool.cpp"
 #include "memory.cpp"
+#include "virtual_memory.cpp"
 #include "arena.cpp"
+#include "shared_arena.cpp"
+#include "budget.cpp"
+#include "alloc_profiler.cpp"
 #include "utf8.cpp"
 #include "strings.cpp"
+#include "hash.cpp"
+#include "intern.cpp"
+#include "rope.cpp"
+#include "bitset.cpp"
+#include "bloom.cpp"
+#include "sort.cpp"
 
 #if defined(USE_MIMALLOC)
 #include "mi_allocator.cpp"
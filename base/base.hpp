@@ -73,6 +73,19 @@ T clamp(T lo, T x, T hi){
 	return min(max(lo, x), hi);
 }
 
+template<typename T>
+void swap(T* a, T* b){
+	T tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+// Default ordering for containers and algorithms that take a comparator
+template<typename T>
+struct Less {
+	constexpr bool operator()(T const& a, T const& b) const { return a < b; }
+};
+
 static_assert(sizeof(f32) == 4 && sizeof(f64) == 8, "Bad float size");
 static_assert(sizeof(isize) == sizeof(isize), "Mismatched (i/u)size");
 static_assert(sizeof(void(*)(void)) == sizeof(void*), "Function pointers and data pointers must be of the same width");
@@ -159,6 +172,93 @@ namespace impl_defer {
 #define defer(Stmt) auto _impl_defer_concat_counter(_defer_) = ::impl_defer::make_deferred([&](){ do { Stmt ; } while(0); return; })
 }
 
+//// Sync
+static inline
+void cpu_relax(){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ volatile("yield");
+#endif
+}
+
+struct SpinLock {
+	Atomic<bool> _locked{false};
+};
+
+static inline
+bool spin_try_lock(SpinLock* l){
+	return !l->_locked.load(std::memory_order_relaxed) && !l->_locked.exchange(true, std::memory_order_acquire);
+}
+
+static inline
+void spin_lock(SpinLock* l){
+	while(!spin_try_lock(l)){
+		while(l->_locked.load(std::memory_order_relaxed)){
+			cpu_relax();
+		}
+	}
+}
+
+static inline
+void spin_unlock(SpinLock* l){
+	l->_locked.store(false, std::memory_order_release);
+}
+
+// Sleep until woken up, as long as *addr still holds `expected`. May wake up
+// spuriously, callers must re-check their condition.
+void futex_wait(Atomic<u32>* addr, u32 expected);
+
+void futex_wake_one(Atomic<u32>* addr);
+
+void futex_wake_all(Atomic<u32>* addr);
+
+// Counts outstanding units of work, waiters sleep until it drops to zero
+struct WaitGroup {
+	Atomic<u32> _pending{0};
+};
+
+static inline
+void wait_group_add(WaitGroup* wg, u32 count){
+	wg->_pending.fetch_add(count, std::memory_order_acq_rel);
+}
+
+static inline
+void wait_group_done(WaitGroup* wg){
+	if(wg->_pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+		futex_wake_all(&wg->_pending);
+	}
+}
+
+static inline
+void wait_group_wait(WaitGroup* wg){
+	for(;;){
+		u32 pending = wg->_pending.load(std::memory_order_acquire);
+		if(pending == 0){ return; }
+		futex_wait(&wg->_pending, pending);
+	}
+}
+
+// Epoch based reclamation for memory read by lock free readers. A reader
+// brackets its accesses with epoch_enter/epoch_exit, which only write to a
+// slot owned by the calling thread. A writer that unpublished some memory
+// tags it with epoch_advance() and may free it once the tag is older than
+// epoch_oldest_active(). Every thread that reads has to claim one of
+// `epoch_max_threads` slots, it is released when the thread exits.
+constexpr isize epoch_max_threads = 256;
+
+// May be nested, only the outermost pair counts
+void epoch_enter();
+
+void epoch_exit();
+
+// Start a new epoch, returns the tag for memory unpublished before the call
+u64 epoch_advance();
+
+// Oldest epoch a reader may still be in, U64 max (as in "anything can be
+// freed") if no reader is active
+u64 epoch_oldest_active();
+
 //// Memory
 enum struct AllocatorMode : u8 {
 	Alloc         = 0, // Allocate a chunk of memory (zero filled)
@@ -249,6 +349,12 @@ AllocatorError mem_free_all(Allocator a);
 
 u32 mem_query(Allocator a);
 
+isize mem_page_size();
+
+// Give the pages fully contained in [p, p + count) back to the OS, their
+// contents are lost and will read as zero once touched again.
+void mem_decommit(void* p, isize count);
+
 template<typename T>
 T* make(Allocator a){
 	auto p = (T*)mem_alloc(a, sizeof(T), alignof(T)).value;
@@ -257,7 +363,7 @@ T* make(Allocator a){
 
 template<typename T>
 void destroy(T* ptr, Allocator a){
-	mem_free(a, ptr, sizeof(T));
+	mem_free(a, ptr, sizeof(T), alignof(T));
 }
 
 template<typename T>
@@ -268,7 +374,7 @@ Slice<T> make(isize n, Allocator a){
 
 template<typename T>
 void destroy(Slice<T> s, Allocator a){
-	mem_free(a, (void*)raw_data(s), sizeof(T) * len(s));
+	mem_free(a, (void*)raw_data(s), sizeof(T) * len(s), alignof(T));
 }
 
 //// Arena
@@ -276,6 +382,8 @@ struct Arena {
 	void* data;
 	isize offset;
 	isize capacity;
+	isize peak_offset; // Highest offset reached since the last decommit
+	isize retain_size; // Memory above this is decommitted on reset, negative disables it
 	void* last_allocation;
 	i32 region_count;
 	AllocatorError last_error;
@@ -294,12 +402,56 @@ bool arena_resize_in_place(Arena* arena, void* ptr, isize size);
 
 void arena_free_all(Arena* arena);
 
+// Decommit the pages above max(offset, retain_size) whenever the arena is
+// reset or a region ends. A negative retain_size disables it (the default).
+void arena_set_decommit(Arena* arena, isize retain_size);
+
 ArenaRegion arena_region_begin(Arena* a);
 
 void arena_region_end(ArenaRegion reg);
 
 Allocator arena_allocator(Arena* arena);
 
+//// Budget
+// Byte limit shared by every allocator charging it, safe to use from multiple
+// threads. Budgets may be nested, a charge to a child is also charged to all
+// of its parents.
+using BudgetReclaimFunc = isize(*)(void* data, isize requested);
+
+struct Budget {
+	Atomic<isize>     used;
+	isize             limit;
+	Budget*           parent;
+	BudgetReclaimFunc reclaim; // Optional, asked to free memory when the limit is hit
+	void*             reclaim_data;
+};
+
+void budget_init(Budget* b, isize limit, Budget* parent = nullptr);
+
+// The callback should free roughly `requested` bytes (e.g. by shrinking a
+// cache) and return how much it released. It is called at most once per
+// failed charge, after which the charge is retried.
+void budget_set_reclaim(Budget* b, BudgetReclaimFunc func, void* data);
+
+[[nodiscard]]
+bool budget_charge(Budget* b, isize size);
+
+void budget_release(Budget* b, isize size);
+
+// Allocator charging a budget, forwarding to `parent` as long as allocations
+// fit and failing with OutOfMemory otherwise. Any number of them, each with
+// its own parent, may share a budget. Each one tracks what it charged so a
+// FreeAll only releases its own share.
+struct BudgetAllocator {
+	Budget*       budget;
+	Allocator     parent;
+	Atomic<isize> charged;
+};
+
+void budget_allocator_init(BudgetAllocator* ba, Budget* b, Allocator parent);
+
+Allocator budget_allocator(BudgetAllocator* ba);
+
 //// Dynamic Array
 constexpr isize dynamic_array_default_capacity = 16;
 
@@ -358,7 +510,7 @@ void clear(DynamicArray<T>* arr){
 
 template<typename T>
 void destroy(DynamicArray<T>* arr){
-	mem_free(arr->_allocator, arr->_data, arr->_capacity * sizeof(T));
+	mem_free(arr->_allocator, arr->_data, arr->_capacity * sizeof(T), alignof(T));
 	arr->_capacity = 0;
 }
 
@@ -440,157 +592,2408 @@ auto allocator(DynamicArray<T> const& a) { return a._allocator; }
 template<typename T> constexpr
 auto slice(DynamicArray<T> a) { return a[{0, a._length}]; }
 
-//// Array
+//// Small Array
+// DynamicArray with inline room for N elements, memory is only requested
+// from the allocator once it grows past that.
 template<typename T, int N>
-struct Array {
-	T v[N];
+struct SmallArray {
+	T         _inline[N];
+	T*        _heap; // nullptr while the elements are stored inline
+	isize     _capacity;
+	isize     _length;
+	Allocator _allocator;
 
 	T& operator[](isize idx){
-		bounds_check_assert(idx >= 0 && idx < N, "Index to slice is out of bounds");
-		return v[idx];
+		bounds_check_assert(idx >= 0 && idx < _length, "Out of bounds access to small array");
+		return _heap ? _heap[idx] : _inline[idx];
 	}
 
-	T const& operator[](isize idx) const {
-		bounds_check_assert(idx >= 0 && idx < N, "Index to slice is out of bounds");
-		return v[idx];
+	T const& operator[](isize idx) const{
+		bounds_check_assert(idx >= 0 && idx < _length, "Out of bounds access to small array");
+		return _heap ? _heap[idx] : _inline[idx];
 	}
 
-	static_assert(N >= 0, "Array length must be greater than 0");
-};
-
-template<typename T, int N> constexpr
-isize len(Array<T, N>){ return N; }
-
-#include "internal_array_overloads.gen.cpp"
-
-//// UTF-8
-struct UTF8DecodeResult {
-	rune codepoint;
-	i32 size;
-};
-
-struct UTF8EncodeResult {
-	Array<byte, 4> data;
-	i32 size;
+	static_assert(N > 0, "Small array must have inline capacity");
 };
 
-static inline
-bool utf8_is_continuation(rune c){
-	static const rune CONTINUATION1 = 0x80;
-	static const rune CONTINUATION2 = 0xbf;
-	return (c >= CONTINUATION1) && (c <= CONTINUATION2);
+template<typename T, int N>
+SmallArray<T, N> make_small_array(Allocator allocator){
+	SmallArray<T, N> arr{};
+	arr._heap      = nullptr;
+	arr._capacity  = N;
+	arr._length    = 0;
+	arr._allocator = allocator;
+	return arr;
 }
 
+template<typename T, int N> constexpr
+T* raw_data(SmallArray<T, N>& a){ return a._heap ? a._heap : a._inline; }
 
-UTF8EncodeResult utf8_encode(rune r);
+template<typename T, int N>
+void destroy(SmallArray<T, N>* arr){
+	if(arr->_heap){
+		mem_free(arr->_allocator, arr->_heap, arr->_capacity * sizeof(T), alignof(T));
+	}
+	arr->_heap = nullptr;
+	arr->_capacity = N;
+	arr->_length = 0;
+}
 
-UTF8DecodeResult utf8_decode(Slice<byte> s);
+template<typename T, int N>
+void clear(SmallArray<T, N>* arr){
+	arr->_length = 0;
+}
 
-struct UTF8Iterator {
-	Slice<byte> data;
-	isize current;
+template<typename T, int N>
+AllocatorError reserve(SmallArray<T, N>* arr, isize new_cap){
+	if(new_cap <= arr->_capacity){ return {}; }
 
-	// WARNING: C++ Iterator insanity. C++ has some of the most shit
-	// iterator design in any programming language and it should not be
-	// taken seriously. This is *ONLY* to be able to iterate strings nicely.
-	void operator++(){
-		this->current += 1;
-		while(this->current < len(this->data) && utf8_is_continuation(this->data._data[this->current])){
-			this->current += 1;
+	if(arr->_heap == nullptr){
+		auto [new_data, err] = mem_alloc(arr->_allocator, new_cap * sizeof(T), alignof(T));
+		if(!new_data){
+			return err;
 		}
+		mem_copy_no_overlap(new_data, arr->_inline, arr->_length * sizeof(T));
+		arr->_heap = (T*)new_data;
 	}
-	void operator--(){
-		this->current -= 1;
-		while(this->current > 0 && utf8_is_continuation(this->data._data[this->current])){
-			this->current -= 1;
+	else {
+		auto [new_data, err] = mem_realloc(arr->_allocator, arr->_heap, arr->_capacity * sizeof(T), alignof(T), new_cap * sizeof(T), alignof(T));
+		if(!new_data){
+			return err;
 		}
+		arr->_heap = (T*)new_data;
 	}
-	rune operator*(){
-		return utf8_decode(this->data[ {this->current, len(this->data)} ]).codepoint;
-	}
-	bool operator!=(UTF8Iterator const& it){
-		return &raw_data(this->data)[this->current] != &raw_data(it.data)[it.current];
+	arr->_capacity = new_cap;
+	return {};
+}
+
+template<typename T, int N>
+AllocatorError append(SmallArray<T, N>* arr, T elem){
+	if(arr->_length >= arr->_capacity){
+		auto err = reserve(arr, max(arr->_length * 2, dynamic_array_default_capacity));
+		if(!ok(err)){
+			return err;
+		}
 	}
-	UTF8Iterator begin(){ return {data, 0}; }
-	UTF8Iterator end(){ return {data, len(data)}; }
-};
+	raw_data(*arr)[arr->_length] = elem;
+	arr->_length += 1;
+	return {};
+}
 
-constexpr rune ERROR_RUNE = 0xfffd;
+template<typename T, int N>
+bool pop(SmallArray<T, N>* arr){
+	if(arr->_length < 1){ return false; }
+	arr->_length -= 1;
+	return true;
+}
 
-constexpr UTF8EncodeResult ERROR_RUNE_UTF8 = {
-	.data = {0xef, 0xbf, 0xbd},
-	.size = 0,
-};
+template<typename T, int N>
+bool insert(SmallArray<T, N>* arr, isize idx, T elem){
+	bounds_check_assert(idx >= 0 && idx <= arr->_length, "Out of bounds index to insert");
+	if(!ok(append(arr, elem))){ return false; }
 
-bool iter_done(UTF8Iterator* it);
+	T* data = raw_data(*arr);
+	isize nbytes = sizeof(T) * (arr->_length - 1 - idx);
+	mem_copy(&data[idx + 1], &data[idx], nbytes);
+	data[idx] = elem;
+	return true;
+}
 
-UTF8DecodeResult iter_advance(UTF8Iterator* it);
+template<typename T, int N>
+void remove(SmallArray<T, N>* arr, isize idx){
+	bounds_check_assert(idx >= 0 && idx < arr->_length, "Out of bounds index to remove");
+	T* data = raw_data(*arr);
+	isize nbytes = sizeof(T) * (arr->_length - idx - 1);
+	mem_copy(&data[idx], &data[idx + 1], nbytes);
+	arr->_length -= 1;
+}
 
-UTF8DecodeResult iter_rewind(UTF8Iterator* it);
+template<typename T, int N>
+bool insert_swap(SmallArray<T, N>* arr, isize idx, T elem){
+	bounds_check_assert(idx >= 0 && idx <= arr->_length, "Out of bounds index to insert_swap");
+	if(idx == arr->_length){ return ok(append(arr, elem)); }
 
-//// Strings
-static inline
-isize cstring_len(char const* cstr){
-	isize size = 0;
-	for(isize i = 0; cstr[i] != 0; i += 1){
-		size += 1;
-	}
-	return size;
+	if(!ok(append(arr, raw_data(*arr)[idx]))){ return false; }
+	raw_data(*arr)[idx] = elem;
+	return true;
 }
 
-struct String {
-	byte const* _data;
-	isize _length;
+template<typename T, int N>
+void remove_swap(SmallArray<T, N>* arr, isize idx){
+	bounds_check_assert(idx >= 0 && idx < arr->_length, "Out of bounds index to remove_swap");
+	T* data = raw_data(*arr);
+	data[idx] = data[arr->_length - 1];
+	arr->_length -= 1;
+}
 
-	String() : _data{0}, _length{0} {}
-	String(const char* cs) : _data{(byte const*)cs}, _length{cstring_len(cs)}{}
-	explicit String(byte const* p, isize n) : _data{p}, _length{n}{}
-	explicit String(Slice<byte> s) : _data{raw_data(s)}, _length{len(s)}{}
+template<typename T, int N> constexpr
+auto len(SmallArray<T, N> const& a) { return a._length; }
 
-	byte operator[](isize idx){
-		bounds_check_assert(idx >= 0 && idx < _length, "Index to string is out of bounds");
-		return _data[idx];
-	}
+template<typename T, int N> constexpr
+auto cap(SmallArray<T, N> const& a) { return a._capacity; }
 
-	String operator[](Pair<isize> range) const noexcept {
-		isize from = range.a;
-		isize to   = range.b;
-		bounds_check_assert(from >= 0 && from < _length && to >= 0 && to <= _length && from <= to, "Index to sub-string is out of bounds");
+template<typename T, int N> constexpr
+auto allocator(SmallArray<T, N> const& a) { return a._allocator; }
 
-		return String(&_data[from], to - from);
+// The slice points into the array itself while it is inline, it is
+// invalidated when the array is moved or grows.
+template<typename T, int N> constexpr
+auto slice(SmallArray<T, N>& a) { return Slice<T>(raw_data(a), a._length); }
+
+//// Segmented Array
+// Growable array made of geometrically larger chunks (each one doubles the
+// size of the previous), growing only ever allocates a new chunk, so elements
+// never move and pointers to them stay valid until they are removed.
+constexpr isize segmented_array_max_chunks = 48;
+
+template<typename T>
+struct SegmentedArray {
+	T*        _chunks[segmented_array_max_chunks];
+	isize     _length;
+	i32       _chunk_count;
+	i32       _first_shift; // log2 of the length of the first chunk
+	Allocator _allocator;
+
+	T& operator[](isize idx){
+		bounds_check_assert(idx >= 0 && idx < _length, "Out of bounds access to segmented array");
+		u64 x = u64(idx >> _first_shift) + 1;
+		isize chunk = 63 - __builtin_clzll(x);
+		return _chunks[chunk][idx - (((isize(1) << chunk) - 1) << _first_shift)];
 	}
 
-	bool operator==(String lhs) const noexcept {
-		if(lhs._length != _length){ return false; }
-		return mem_compare(_data, lhs._data, _length) == 0;
+	T const& operator[](isize idx) const {
+		bounds_check_assert(idx >= 0 && idx < _length, "Out of bounds access to segmented array");
+		u64 x = u64(idx >> _first_shift) + 1;
+		isize chunk = 63 - __builtin_clzll(x);
+		return _chunks[chunk][idx - (((isize(1) << chunk) - 1) << _first_shift)];
 	}
+};
 
-	bool operator!=(String lhs) const noexcept {
-		if(lhs._length != _length){ return false; }
-		return mem_compare(_data, lhs._data, _length) != 0;
+template<typename T>
+SegmentedArray<T> make_segmented_array(Allocator allocator, isize first_chunk = dynamic_array_default_capacity){
+	ensure(mem_valid_alignment(first_chunk), "First chunk length must be a power of 2");
+	SegmentedArray<T> arr;
+	for(isize i = 0; i < segmented_array_max_chunks; i += 1){
+		arr._chunks[i] = nullptr;
 	}
+	arr._length      = 0;
+	arr._chunk_count = 0;
+	arr._first_shift = __builtin_ctzll(u64(first_chunk));
+	arr._allocator   = allocator;
+	return arr;
+}
 
-	// C++ Iterator bs
+template<typename T> constexpr
+isize chunk_length(SegmentedArray<T> const& a, isize chunk){
+	return isize(1) << (chunk + a._first_shift);
+}
 
-	UTF8Iterator begin(){ return {Slice((byte*)_data, _length), 0}; }
-	UTF8Iterator end(){ return {Slice((byte*)_data, _length), _length}; }
-};
+template<typename T>
+void destroy(SegmentedArray<T>* arr){
+	for(isize i = 0; i < arr->_chunk_count; i += 1){
+		mem_free(arr->_allocator, arr->_chunks[i], chunk_length(*arr, i) * sizeof(T), alignof(T));
+		arr->_chunks[i] = nullptr;
+	}
+	arr->_chunk_count = 0;
+	arr->_length = 0;
+}
 
-static inline
-isize len(String s){ return s._length; }
+template<typename T>
+void clear(SegmentedArray<T>* arr){
+	arr->_length = 0;
+}
 
-static inline
-byte const* raw_data(String s){ return s._data; }
+template<typename T> constexpr
+auto len(SegmentedArray<T> const& a) { return a._length; }
 
-String str_clone(String s, Allocator a);
+template<typename T> constexpr
+isize cap(SegmentedArray<T> const& a) {
+	return ((isize(1) << a._chunk_count) - 1) << a._first_shift;
+}
 
-String str_concat(String s0, String s1, Allocator a);
+template<typename T> constexpr
+auto allocator(SegmentedArray<T> const& a) { return a._allocator; }
 
-isize str_rune_count(String s);
+template<typename T>
+AllocatorError append(SegmentedArray<T>* arr, T elem){
+	if(arr->_length >= cap(*arr)){
+		ensure(arr->_chunk_count < segmented_array_max_chunks, "Segmented array is out of chunks");
+		isize n = chunk_length(*arr, arr->_chunk_count);
+		auto [data, err] = mem_alloc(arr->_allocator, n * sizeof(T), alignof(T));
+		if(!data){
+			return err;
+		}
+		arr->_chunks[arr->_chunk_count] = (T*)data;
+		arr->_chunk_count += 1;
+	}
+	arr->_length += 1;
+	(*arr)[arr->_length - 1] = elem;
+	return {};
+}
 
-bool str_starts_with(String s, String prefix);
+template<typename T>
+bool pop(SegmentedArray<T>* arr){
+	if(arr->_length < 1){ return false; }
+	arr->_length -= 1;
+	return true;
+}
 
-bool str_ends_with(String s, String suffix);
+template<typename T>
+void remove_swap(SegmentedArray<T>* arr, isize idx){
+	bounds_check_assert(idx >= 0 && idx < arr->_length, "Out of bounds index to remove_swap");
+	(*arr)[idx] = (*arr)[arr->_length - 1];
+	arr->_length -= 1;
+}
+
+template<typename T> constexpr
+isize chunk_count(SegmentedArray<T> const& a){
+	return a._chunk_count;
+}
+
+// Elements stored in a chunk, for processing the array a contiguous run at a time
+template<typename T>
+Slice<T> chunk(SegmentedArray<T>* arr, isize idx){
+	bounds_check_assert(idx >= 0 && idx < arr->_chunk_count, "Out of bounds chunk index");
+	isize start = ((isize(1) << idx) - 1) << arr->_first_shift;
+	isize n = clamp(isize(0), arr->_length - start, chunk_length(*arr, idx));
+	return Slice<T>(arr->_chunks[idx], n);
+}
+
+//// SoA Array
+// Structure of arrays: every field lives in its own column, so a loop over a
+// couple of fields streams only those bytes. All columns share one block and
+// each starts on a cache line boundary. Fields are addressed by index:
+//   auto particles = make_soa_array<Vec2, Vec2, f32>(allocator);
+//   append(&particles, pos, vel, mass);
+//   Slice<Vec2> positions = column<0>(particles);
+namespace impl_soa {
+	template<isize I, typename T, typename... Rest>
+	struct TypeAt { using Type = typename TypeAt<I - 1, Rest...>::Type; };
+
+	template<typename T, typename... Rest>
+	struct TypeAt<0, T, Rest...> { using Type = T; };
+
+	// Byte offset of each column for a given capacity, returns the total size
+	template<typename... Fields>
+	isize layout(isize capacity, isize* offsets){
+		isize offset = 0, i = 0;
+		((offset = mem_align_forward_size(offset, max(isize(alignof(Fields)), cache_line_size)),
+		  offsets[i] = offset,
+		  offset += capacity * isize(sizeof(Fields)),
+		  i += 1), ...);
+		return offset;
+	}
+}
+
+template<typename... Fields>
+struct SoaArray {
+	static_assert(sizeof...(Fields) > 0, "SoaArray needs at least one field");
+	static constexpr isize field_count = sizeof...(Fields);
+
+	byte*     _block;
+	void*     _columns[sizeof...(Fields)];
+	isize     _capacity;
+	isize     _length;
+	Allocator _allocator;
+};
+
+template<typename... Fields> constexpr
+auto len(SoaArray<Fields...> const& a) { return a._length; }
+
+template<typename... Fields> constexpr
+auto cap(SoaArray<Fields...> const& a) { return a._capacity; }
+
+template<typename... Fields> constexpr
+auto allocator(SoaArray<Fields...> const& a) { return a._allocator; }
+
+template<isize I, typename... Fields>
+auto column(SoaArray<Fields...> const& a){
+	static_assert(I >= 0 && I < isize(sizeof...(Fields)), "Column index out of range");
+	using T = typename impl_soa::TypeAt<I, Fields...>::Type;
+	return Slice<T>((T*)a._columns[I], a._length);
+}
+
+template<typename... Fields>
+AllocatorError reserve(SoaArray<Fields...>* arr, isize new_cap){
+	if(new_cap <= arr->_capacity){ return {}; }
+
+	isize offsets[sizeof...(Fields)];
+	isize size = impl_soa::layout<Fields...>(new_cap, offsets);
+	auto [block, err] = mem_alloc(arr->_allocator, size, cache_line_size);
+	if(!block){ return err; }
+
+	isize i = 0;
+	((mem_copy((byte*)block + offsets[i], arr->_columns[i], arr->_length * isize(sizeof(Fields))), i += 1), ...);
+
+	if(arr->_block){
+		isize old_offsets[sizeof...(Fields)];
+		isize old_size = impl_soa::layout<Fields...>(arr->_capacity, old_offsets);
+		mem_free(arr->_allocator, arr->_block, old_size, cache_line_size);
+	}
+
+	arr->_block = (byte*)block;
+	for(isize c = 0; c < isize(sizeof...(Fields)); c += 1){
+		arr->_columns[c] = (byte*)block + offsets[c];
+	}
+	arr->_capacity = new_cap;
+	return {};
+}
+
+template<typename... Fields>
+SoaArray<Fields...> make_soa_array(Allocator allocator, isize initial_cap = 0){
+	SoaArray<Fields...> arr;
+	arr._block = nullptr;
+	for(isize i = 0; i < isize(sizeof...(Fields)); i += 1){
+		arr._columns[i] = nullptr;
+	}
+	arr._capacity  = 0;
+	arr._length    = 0;
+	arr._allocator = allocator;
+	if(initial_cap > 0){
+		reserve(&arr, initial_cap);
+	}
+	return arr;
+}
+
+template<typename... Fields>
+void destroy(SoaArray<Fields...>* arr){
+	if(arr->_block){
+		isize offsets[sizeof...(Fields)];
+		isize size = impl_soa::layout<Fields...>(arr->_capacity, offsets);
+		mem_free(arr->_allocator, arr->_block, size, cache_line_size);
+	}
+	arr->_block = nullptr;
+	for(isize i = 0; i < isize(sizeof...(Fields)); i += 1){
+		arr->_columns[i] = nullptr;
+	}
+	arr->_capacity = 0;
+	arr->_length = 0;
+}
+
+template<typename... Fields>
+void clear(SoaArray<Fields...>* arr){
+	arr->_length = 0;
+}
+
+template<typename... Fields>
+AllocatorError append(SoaArray<Fields...>* arr, Fields... values){
+	if(arr->_length >= arr->_capacity){
+		auto err = reserve(arr, max(arr->_capacity * 2, dynamic_array_default_capacity));
+		if(!ok(err)){ return err; }
+	}
+	isize i = 0, n = arr->_length;
+	((((Fields*)arr->_columns[i])[n] = values, i += 1), ...);
+	arr->_length += 1;
+	return {};
+}
+
+template<typename... Fields>
+bool pop(SoaArray<Fields...>* arr){
+	if(arr->_length < 1){ return false; }
+	arr->_length -= 1;
+	return true;
+}
+
+// Move the last row into `idx`, in every column
+template<typename... Fields>
+void remove_swap(SoaArray<Fields...>* arr, isize idx){
+	bounds_check_assert(idx >= 0 && idx < arr->_length, "Out of bounds index to remove_swap");
+	isize i = 0, last = arr->_length - 1;
+	((((Fields*)arr->_columns[i])[idx] = ((Fields*)arr->_columns[i])[last], i += 1), ...);
+	arr->_length -= 1;
+}
+
+//// Slot Map
+// Values are kept densely packed for iteration, handles reach them through an
+// indirection table. Every slot carries a generation that is bumped when its
+// value is removed, so a handle to a removed value is detected as stale even
+// after the slot gets reused. Removal moves the last value into the hole.
+struct SlotMapHandle {
+	u32 index;
+	u32 generation;
+};
+
+struct SlotMapSlot {
+	i32 dense;      // Index into the values, or next free slot (-1 ends the list)
+	u32 generation;
+};
+
+template<typename T>
+struct SlotMap {
+	DynamicArray<T>           _values;
+	DynamicArray<i32>         _value_slots; // Dense index -> slot
+	DynamicArray<SlotMapSlot> _slots;
+	i32                       _free_slot;
+};
+
+template<typename T>
+SlotMap<T> make_slot_map(Allocator allocator, isize cap = dynamic_array_default_capacity){
+	SlotMap<T> sm;
+	sm._values = make_dynamic_array<T>(allocator, cap);
+	sm._value_slots = make_dynamic_array<i32>(allocator, cap);
+	sm._slots = make_dynamic_array<SlotMapSlot>(allocator, cap);
+	sm._free_slot = -1;
+	return sm;
+}
+
+template<typename T>
+void destroy(SlotMap<T>* sm){
+	destroy(&sm->_values);
+	destroy(&sm->_value_slots);
+	destroy(&sm->_slots);
+	sm->_free_slot = -1;
+}
+
+// Remove every value, all outstanding handles become stale
+template<typename T>
+void clear(SlotMap<T>* sm){
+	for(isize i = 0; i < sm->_value_slots._length; i += 1){
+		i32 s = sm->_value_slots._data[i];
+		sm->_slots._data[s].generation += 1;
+		sm->_slots._data[s].dense = sm->_free_slot;
+		sm->_free_slot = s;
+	}
+	clear(&sm->_values);
+	clear(&sm->_value_slots);
+}
+
+template<typename T> constexpr
+auto len(SlotMap<T> const& sm){ return sm._values._length; }
+
+// Dense view of the values, in no particular order
+template<typename T>
+Slice<T> values(SlotMap<T> const& sm){
+	return Slice<T>(sm._values._data, sm._values._length);
+}
+
+// Handle of the value at a dense index
+template<typename T>
+SlotMapHandle handle_at(SlotMap<T> const& sm, isize idx){
+	bounds_check_assert(idx >= 0 && idx < sm._values._length, "Out of bounds index to slot map");
+	i32 s = sm._value_slots._data[idx];
+	return { u32(s), sm._slots._data[s].generation };
+}
+
+template<typename T>
+Result<SlotMapHandle, AllocatorError> insert(SlotMap<T>* sm, T value){
+	i32 s = sm->_free_slot;
+	bool new_slot = s < 0;
+	if(new_slot){
+		auto err = append(&sm->_slots, SlotMapSlot{ -1, 0 });
+		if(!ok(err)){ return { {}, err }; }
+		s = i32(sm->_slots._length - 1);
+	}
+
+	auto err = append(&sm->_values, value);
+	if(ok(err)){
+		err = append(&sm->_value_slots, s);
+		if(!ok(err)){ sm->_values._length -= 1; }
+	}
+	if(!ok(err)){
+		if(new_slot){ sm->_slots._length -= 1; }
+		return { {}, err };
+	}
+
+	SlotMapSlot& slot = sm->_slots._data[s];
+	if(!new_slot){ sm->_free_slot = slot.dense; }
+	slot.dense = i32(sm->_values._length - 1);
+	return { SlotMapHandle{ u32(s), slot.generation } };
+}
+
+// Pointer to the value, or nullptr if the handle is stale. The pointer is
+// invalidated by any insert or remove.
+template<typename T>
+T* find(SlotMap<T>* sm, SlotMapHandle h){
+	if(isize(h.index) >= sm->_slots._length){ return nullptr; }
+	SlotMapSlot slot = sm->_slots._data[h.index];
+	if(slot.generation != h.generation){ return nullptr; }
+	// Guards against handles that were never issued by this map
+	if(slot.dense < 0 || slot.dense >= sm->_values._length || sm->_value_slots._data[slot.dense] != i32(h.index)){
+		return nullptr;
+	}
+	return &sm->_values._data[slot.dense];
+}
+
+template<typename T>
+bool remove(SlotMap<T>* sm, SlotMapHandle h){
+	if(!find(sm, h)){ return false; }
+
+	SlotMapSlot& slot = sm->_slots._data[h.index];
+	i32 dense = slot.dense;
+	i32 last = i32(sm->_values._length - 1);
+
+	// Fill the hole with the last value and repoint its slot
+	i32 moved = sm->_value_slots._data[last];
+	sm->_values._data[dense] = sm->_values._data[last];
+	sm->_value_slots._data[dense] = moved;
+	sm->_slots._data[moved].dense = dense;
+	sm->_values._length -= 1;
+	sm->_value_slots._length -= 1;
+
+	slot.generation += 1;
+	slot.dense = sm->_free_slot;
+	sm->_free_slot = i32(h.index);
+	return true;
+}
+
+//// Deque
+// Ring buffer with a power of 2 capacity, pushing and popping at either end
+// is O(1) (amortized when it has to grow).
+template<typename T>
+struct Deque {
+	T*        _data;
+	isize     _capacity; // 0 or a power of 2
+	isize     _head;
+	isize     _length;
+	Allocator _allocator;
+
+	T& operator[](isize idx){
+		bounds_check_assert(idx >= 0 && idx < _length, "Out of bounds access to deque");
+		return _data[(_head + idx) & (_capacity - 1)];
+	}
+
+	T const& operator[](isize idx) const {
+		bounds_check_assert(idx >= 0 && idx < _length, "Out of bounds access to deque");
+		return _data[(_head + idx) & (_capacity - 1)];
+	}
+};
+
+// The elements in order as (at most) two contiguous runs, the second one is
+// empty unless the elements wrap around the end of the buffer.
+template<typename T>
+Pair<Slice<T>> slices(Deque<T>* dq){
+	isize first = min(dq->_length, dq->_capacity - dq->_head);
+	return {
+		Slice<T>(dq->_data + dq->_head, first),
+		Slice<T>(dq->_data, dq->_length - first),
+	};
+}
+
+template<typename T>
+AllocatorError reserve(Deque<T>* dq, isize count){
+	if(count <= dq->_capacity){ return {}; }
+
+	isize new_cap = dynamic_array_default_capacity;
+	while(new_cap < count){
+		new_cap *= 2;
+	}
+
+	auto [new_data, err] = mem_alloc(dq->_allocator, new_cap * sizeof(T), alignof(T));
+	if(!new_data){
+		return err;
+	}
+
+	// Unwrap the elements to the start of the new buffer
+	auto [a, b] = slices(dq);
+	mem_copy_no_overlap(new_data, raw_data(a), len(a) * sizeof(T));
+	mem_copy_no_overlap((T*)new_data + len(a), raw_data(b), len(b) * sizeof(T));
+
+	if(dq->_data){
+		mem_free(dq->_allocator, dq->_data, dq->_capacity * sizeof(T), alignof(T));
+	}
+	dq->_data = (T*)new_data;
+	dq->_capacity = new_cap;
+	dq->_head = 0;
+	return {};
+}
+
+template<typename T>
+Deque<T> make_deque(Allocator allocator, isize cap = dynamic_array_default_capacity){
+	Deque<T> dq;
+	dq._data      = nullptr;
+	dq._capacity  = 0;
+	dq._head      = 0;
+	dq._length    = 0;
+	dq._allocator = allocator;
+	reserve(&dq, cap);
+	return dq;
+}
+
+template<typename T>
+void destroy(Deque<T>* dq){
+	if(dq->_data){
+		mem_free(dq->_allocator, dq->_data, dq->_capacity * sizeof(T), alignof(T));
+	}
+	dq->_data = nullptr;
+	dq->_capacity = 0;
+	dq->_head = 0;
+	dq->_length = 0;
+}
+
+template<typename T>
+void clear(Deque<T>* dq){
+	dq->_head = 0;
+	dq->_length = 0;
+}
+
+template<typename T>
+AllocatorError push_back(Deque<T>* dq, T elem){
+	if(dq->_length >= dq->_capacity){
+		auto err = reserve(dq, max(dq->_capacity * 2, dynamic_array_default_capacity));
+		if(!ok(err)){ return err; }
+	}
+	dq->_data[(dq->_head + dq->_length) & (dq->_capacity - 1)] = elem;
+	dq->_length += 1;
+	return {};
+}
+
+template<typename T>
+AllocatorError push_front(Deque<T>* dq, T elem){
+	if(dq->_length >= dq->_capacity){
+		auto err = reserve(dq, max(dq->_capacity * 2, dynamic_array_default_capacity));
+		if(!ok(err)){ return err; }
+	}
+	dq->_head = (dq->_head - 1) & (dq->_capacity - 1);
+	dq->_data[dq->_head] = elem;
+	dq->_length += 1;
+	return {};
+}
+
+// Removes the last element, copying it to `out` when not null.
+template<typename T>
+bool pop_back(Deque<T>* dq, T* out = nullptr){
+	if(dq->_length < 1){ return false; }
+	dq->_length -= 1;
+	if(out){ *out = dq->_data[(dq->_head + dq->_length) & (dq->_capacity - 1)]; }
+	return true;
+}
+
+// Removes the first element, copying it to `out` when not null.
+template<typename T>
+bool pop_front(Deque<T>* dq, T* out = nullptr){
+	if(dq->_length < 1){ return false; }
+	if(out){ *out = dq->_data[dq->_head]; }
+	dq->_head = (dq->_head + 1) & (dq->_capacity - 1);
+	dq->_length -= 1;
+	return true;
+}
+
+template<typename T> constexpr
+auto len(Deque<T> const& dq) { return dq._length; }
+
+template<typename T> constexpr
+auto cap(Deque<T> const& dq) { return dq._capacity; }
+
+template<typename T> constexpr
+auto allocator(Deque<T> const& dq) { return dq._allocator; }
+
+//// SPSC Queue
+// Bounded wait free queue for exactly one producer and one consumer thread.
+// Each side owns one index on its own cache line and keeps a cached copy of
+// the other side's index, so the shared line is only read again when the
+// queue looks full (producer) or empty (consumer).
+template<typename T>
+struct SPSCQueue {
+	// Consumer owned
+	alignas(cache_line_size) Atomic<isize> _head;
+	isize _tail_cache;
+
+	// Producer owned
+	alignas(cache_line_size) Atomic<isize> _tail;
+	isize _head_cache;
+
+	// Read only after init
+	alignas(cache_line_size) T* _data;
+	isize _capacity; // Power of 2
+	Allocator _allocator;
+};
+
+template<typename T>
+AllocatorError spsc_queue_init(SPSCQueue<T>* q, isize capacity, Allocator allocator){
+	ensure(mem_valid_alignment(capacity), "Queue capacity must be a power of 2");
+	auto [data, err] = mem_alloc(allocator, capacity * sizeof(T), alignof(T));
+	if(!data){
+		return err;
+	}
+	q->_head.store(0, std::memory_order_relaxed);
+	q->_tail.store(0, std::memory_order_relaxed);
+	q->_tail_cache = 0;
+	q->_head_cache = 0;
+	q->_data = (T*)data;
+	q->_capacity = capacity;
+	q->_allocator = allocator;
+	return {};
+}
+
+template<typename T>
+void destroy(SPSCQueue<T>* q){
+	mem_free(q->_allocator, q->_data, q->_capacity * sizeof(T), alignof(T));
+	q->_data = nullptr;
+	q->_capacity = 0;
+}
+
+// Producer only. Pushes as many elements of `items` as fit, returns how many.
+template<typename T>
+isize push_bulk(SPSCQueue<T>* q, Slice<T> items){
+	isize tail = q->_tail.load(std::memory_order_relaxed);
+	isize free = q->_capacity - (tail - q->_head_cache);
+	if(free < len(items)){
+		q->_head_cache = q->_head.load(std::memory_order_acquire);
+		free = q->_capacity - (tail - q->_head_cache);
+	}
+
+	isize n = min(free, len(items));
+	if(n == 0){ return 0; }
+
+	isize start = tail & (q->_capacity - 1);
+	isize first = min(n, q->_capacity - start);
+	mem_copy_no_overlap(&q->_data[start], raw_data(items), first * sizeof(T));
+	mem_copy_no_overlap(&q->_data[0], raw_data(items) + first, (n - first) * sizeof(T));
+
+	q->_tail.store(tail + n, std::memory_order_release);
+	return n;
+}
+
+// Consumer only. Pops up to len(out) elements, returns how many.
+template<typename T>
+isize pop_bulk(SPSCQueue<T>* q, Slice<T> out){
+	isize head = q->_head.load(std::memory_order_relaxed);
+	isize available = q->_tail_cache - head;
+	if(available < len(out)){
+		q->_tail_cache = q->_tail.load(std::memory_order_acquire);
+		available = q->_tail_cache - head;
+	}
+
+	isize n = min(available, len(out));
+	if(n == 0){ return 0; }
+
+	isize start = head & (q->_capacity - 1);
+	isize first = min(n, q->_capacity - start);
+	mem_copy_no_overlap(raw_data(out), &q->_data[start], first * sizeof(T));
+	mem_copy_no_overlap(raw_data(out) + first, &q->_data[0], (n - first) * sizeof(T));
+
+	q->_head.store(head + n, std::memory_order_release);
+	return n;
+}
+
+// Producer only
+template<typename T>
+bool try_push(SPSCQueue<T>* q, T elem){
+	isize tail = q->_tail.load(std::memory_order_relaxed);
+	if(tail - q->_head_cache >= q->_capacity){
+		q->_head_cache = q->_head.load(std::memory_order_acquire);
+		if(tail - q->_head_cache >= q->_capacity){ return false; }
+	}
+	q->_data[tail & (q->_capacity - 1)] = elem;
+	q->_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+// Consumer only
+template<typename T>
+bool try_pop(SPSCQueue<T>* q, T* out){
+	isize head = q->_head.load(std::memory_order_relaxed);
+	if(head >= q->_tail_cache){
+		q->_tail_cache = q->_tail.load(std::memory_order_acquire);
+		if(head >= q->_tail_cache){ return false; }
+	}
+	*out = q->_data[head & (q->_capacity - 1)];
+	q->_head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+// Approximate unless called from one of the two sides with the other idle
+template<typename T>
+isize len(SPSCQueue<T> const& q){
+	return q._tail.load(std::memory_order_acquire) - q._head.load(std::memory_order_acquire);
+}
+
+template<typename T> constexpr
+isize cap(SPSCQueue<T> const& q){ return q._capacity; }
+
+//// MPMC Queue
+// Bounded multi producer, multi consumer queue (D. Vyukov's design). Every
+// cell carries a sequence number that tells producers and consumers whether
+// it is their turn, so the only contention is a CAS on the shared position.
+// The blocking variants sleep on a futex and never busy spin. Besides the
+// position CAS the fast path costs a fence and a read of the waiter count,
+// the futex word is only bumped (and woken) when somebody is waiting.
+template<typename T>
+struct MPMCQueueCell {
+	Atomic<isize> seq;
+	T value;
+};
+
+template<typename T>
+struct MPMCQueue {
+	alignas(cache_line_size) Atomic<isize> _enqueue_pos;
+	alignas(cache_line_size) Atomic<isize> _dequeue_pos;
+
+	// Bumped after a push/pop that found sleepers, they wait on them to change
+	alignas(cache_line_size) Atomic<u32> _pushed;
+	Atomic<u32> _consumers_waiting;
+	alignas(cache_line_size) Atomic<u32> _popped;
+	Atomic<u32> _producers_waiting;
+
+	alignas(cache_line_size) MPMCQueueCell<T>* _cells;
+	isize _mask;
+	Allocator _allocator;
+};
+
+template<typename T>
+AllocatorError mpmc_queue_init(MPMCQueue<T>* q, isize capacity, Allocator allocator){
+	ensure(mem_valid_alignment(capacity) && capacity >= 2, "Queue capacity must be a power of 2");
+	auto cells = make<MPMCQueueCell<T>>(capacity, allocator);
+	if(len(cells) == 0){
+		return AllocatorError::OutOfMemory;
+	}
+	for(isize i = 0; i < capacity; i += 1){
+		cells[i].seq.store(i, std::memory_order_relaxed);
+	}
+	q->_enqueue_pos.store(0, std::memory_order_relaxed);
+	q->_dequeue_pos.store(0, std::memory_order_relaxed);
+	q->_pushed.store(0, std::memory_order_relaxed);
+	q->_popped.store(0, std::memory_order_relaxed);
+	q->_consumers_waiting.store(0, std::memory_order_relaxed);
+	q->_producers_waiting.store(0, std::memory_order_relaxed);
+	q->_cells = raw_data(cells);
+	q->_mask = capacity - 1;
+	q->_allocator = allocator;
+	return {};
+}
+
+template<typename T>
+void destroy(MPMCQueue<T>* q){
+	destroy(Slice<MPMCQueueCell<T>>(q->_cells, q->_mask + 1), q->_allocator);
+	q->_cells = nullptr;
+}
+
+template<typename T>
+bool try_push(MPMCQueue<T>* q, T elem){
+	MPMCQueueCell<T>* cell;
+	isize pos = q->_enqueue_pos.load(std::memory_order_relaxed);
+	for(;;){
+		cell = &q->_cells[pos & q->_mask];
+		isize diff = cell->seq.load(std::memory_order_acquire) - pos;
+		if(diff == 0){
+			if(q->_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){ break; }
+		}
+		else if(diff < 0){
+			return false; /* Full */
+		}
+		else {
+			pos = q->_enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->value = elem;
+	cell->seq.store(pos + 1, std::memory_order_release);
+
+	// Pairs with the fence in pop(): either we see the waiter or it sees the value
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(q->_consumers_waiting.load(std::memory_order_relaxed) > 0){
+		q->_pushed.fetch_add(1, std::memory_order_release);
+		futex_wake_one(&q->_pushed);
+	}
+	return true;
+}
+
+template<typename T>
+bool try_pop(MPMCQueue<T>* q, T* out){
+	MPMCQueueCell<T>* cell;
+	isize pos = q->_dequeue_pos.load(std::memory_order_relaxed);
+	for(;;){
+		cell = &q->_cells[pos & q->_mask];
+		isize diff = cell->seq.load(std::memory_order_acquire) - (pos + 1);
+		if(diff == 0){
+			if(q->_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){ break; }
+		}
+		else if(diff < 0){
+			return false; /* Empty */
+		}
+		else {
+			pos = q->_dequeue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	*out = cell->value;
+	cell->seq.store(pos + q->_mask + 1, std::memory_order_release);
+
+	// Pairs with the fence in push(): either we see the waiter or it sees the room
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(q->_producers_waiting.load(std::memory_order_relaxed) > 0){
+		q->_popped.fetch_add(1, std::memory_order_release);
+		futex_wake_one(&q->_popped);
+	}
+	return true;
+}
+
+// Blocks while the queue is full
+template<typename T>
+void push(MPMCQueue<T>* q, T elem){
+	for(;;){
+		u32 seen = q->_popped.load(std::memory_order_acquire);
+		if(try_push(q, elem)){ return; }
+
+		q->_producers_waiting.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(try_push(q, elem)){
+			q->_producers_waiting.fetch_sub(1, std::memory_order_relaxed);
+			return;
+		}
+		futex_wait(&q->_popped, seen);
+		q->_producers_waiting.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+// Blocks while the queue is empty
+template<typename T>
+void pop(MPMCQueue<T>* q, T* out){
+	for(;;){
+		u32 seen = q->_pushed.load(std::memory_order_acquire);
+		if(try_pop(q, out)){ return; }
+
+		q->_consumers_waiting.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(try_pop(q, out)){
+			q->_consumers_waiting.fetch_sub(1, std::memory_order_relaxed);
+			return;
+		}
+		futex_wait(&q->_pushed, seen);
+		q->_consumers_waiting.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+template<typename T> constexpr
+isize cap(MPMCQueue<T> const& q){ return q._mask + 1; }
+
+//// Thread Pool
+// Fixed set of worker threads fed through an MPMC queue. Tasks are a function
+// and a data pointer, completion is tracked with a WaitGroup. A thread waiting
+// on a group runs queued tasks instead of sleeping, so the caller takes part
+// in the work and a pool without workers still makes progress.
+typedef void (*ThreadPoolFunc)(void* data);
+
+struct ThreadPoolTask {
+	ThreadPoolFunc func; // nullptr tells a worker to exit
+	void*          data;
+	WaitGroup*     group;
+};
+
+constexpr isize thread_pool_queue_size = 1024;
+
+struct ThreadPool {
+	MPMCQueue<ThreadPoolTask> _queue;
+	void*                     _threads; // pthread_t[_thread_count]
+	isize                     _thread_count;
+	Allocator                 _allocator;
+};
+
+// Start `thread_count` workers, 0 is allowed
+AllocatorError thread_pool_init(ThreadPool* pool, isize thread_count, Allocator allocator);
+
+// Let the workers finish the queued tasks, then join them
+void thread_pool_destroy(ThreadPool* pool);
+
+// Queue func(data), `group` (may be null) is marked done once it has run
+void thread_pool_submit(ThreadPool* pool, ThreadPoolFunc func, void* data, WaitGroup* group);
+
+// Help running queued tasks until every task of `group` is done
+void thread_pool_wait(ThreadPool* pool, WaitGroup* group);
+
+static inline
+isize thread_count(ThreadPool const& pool){ return pool._thread_count; }
+
+//// Bit Set
+// Fixed size set of bits over a Slice<u64>, bits past `length` in the last word
+// are always kept at zero. Bulk operations work on whole vectors of words.
+struct BitSet {
+	Slice<u64> words;
+	isize length;
+};
+
+static inline
+isize bits_word_count(isize bit_count){
+	return (bit_count + 63) / 64;
+}
+
+// Use caller provided words as storage, len(words) must be at least bits_word_count(bit_count).
+// The words are kept as they are, except for the bits past bit_count which are cleared.
+BitSet bits_from(Slice<u64> words, isize bit_count);
+
+BitSet make_bit_set(isize bit_count, Allocator allocator);
+
+void destroy(BitSet b, Allocator allocator);
+
+static inline
+isize len(BitSet const& b){ return b.length; }
+
+static inline
+void bits_set(BitSet* b, isize idx){
+	bounds_check_assert(idx >= 0 && idx < b->length, "Index to bit set is out of bounds");
+	raw_data(b->words)[idx >> 6] |= u64(1) << (idx & 63);
+}
+
+static inline
+void bits_unset(BitSet* b, isize idx){
+	bounds_check_assert(idx >= 0 && idx < b->length, "Index to bit set is out of bounds");
+	raw_data(b->words)[idx >> 6] &= ~(u64(1) << (idx & 63));
+}
+
+static inline
+bool bits_test(BitSet const& b, isize idx){
+	bounds_check_assert(idx >= 0 && idx < b.length, "Index to bit set is out of bounds");
+	return (raw_data(b.words)[idx >> 6] >> (idx & 63)) & 1;
+}
+
+void bits_clear(BitSet* b);
+
+void bits_fill(BitSet* b);
+
+// In place dst = dst op src, both sets must have the same length.
+void bits_and(BitSet* dst, BitSet const& src);
+
+void bits_or(BitSet* dst, BitSet const& src);
+
+void bits_xor(BitSet* dst, BitSet const& src);
+
+void bits_andnot(BitSet* dst, BitSet const& src);
+
+// Number of set bits
+isize bits_count(BitSet const& b);
+
+// Position of the first set/unset bit at or after `from`, -1 if there is none.
+isize bits_next_set(BitSet const& b, isize from);
+
+isize bits_next_unset(BitSet const& b, isize from);
+
+static inline
+isize bits_first_set(BitSet const& b){ return bits_next_set(b, 0); }
+
+static inline
+isize bits_first_unset(BitSet const& b){ return bits_next_unset(b, 0); }
+
+// Number of set bits in [0, idx)
+isize bits_rank(BitSet const& b, isize idx);
+
+// Position of the n-th (from 0) set bit, -1 if there are not enough bits set.
+isize bits_select(BitSet const& b, isize n);
+
+// Cumulative counts of set bits every 512 bits, makes rank O(1) and select
+// O(log n). Must be rebuilt after the set is modified.
+constexpr isize bits_rank_block_words = 8;
+
+struct BitSetRank {
+	Slice<isize> blocks;
+};
+
+BitSetRank make_bit_set_rank(BitSet const& b, Allocator allocator);
+
+void destroy(BitSetRank r, Allocator allocator);
+
+isize bits_rank(BitSet const& b, BitSetRank const& r, isize idx);
+
+isize bits_select(BitSet const& b, BitSetRank const& r, isize n);
+
+//// Bloom Filter
+// Blocked Bloom filter: a key sets one bit in each of the 8 words of a single
+// 64 byte block, so a probe costs one cache miss instead of k. The bit inside
+// each word comes from multiplying the hash by a per word salt, all 8 lanes
+// are computed and tested at once with vector operations. Keys are given as
+// 64 bit hashes (see hash()).
+constexpr isize bloom_block_words = 8;
+
+struct BloomFilter {
+	u64*  blocks; // block_count * bloom_block_words words, cache line aligned
+	isize block_count;
+};
+
+// Sized for `expected_items` keys at `bits_per_item` bits each, around 10
+// bits give a 1% false positive rate. A filter without blocks (zero
+// initialized) ignores inserts and reports every key as possibly present.
+Result<BloomFilter, AllocatorError> make_bloom_filter(isize expected_items, isize bits_per_item, Allocator allocator);
+
+void destroy(BloomFilter f, Allocator allocator);
+
+void bloom_clear(BloomFilter* f);
+
+void bloom_insert(BloomFilter* f, u64 hash);
+
+// False means the key was definitely never inserted
+bool bloom_contains(BloomFilter const& f, u64 hash);
+
+// Probe every hash, prefetching blocks a few keys ahead. Writes the result
+// for hashes[i] to out[i] and returns how many may be present.
+isize bloom_contains_batch(BloomFilter const& f, Slice<u64> hashes, Slice<bool> out);
+
+// Serialized form is a 64 byte header followed by the blocks, so it can be
+// written to a file and used in place once mapped back.
+isize bloom_serialized_size(BloomFilter const& f);
+
+// Returns false if `out` is too small
+bool bloom_serialize(BloomFilter const& f, Slice<byte> out);
+
+// Use serialized bytes directly as the filter's storage (no copy). The bytes
+// must be 8 byte aligned, returns false if they don't hold a valid filter.
+bool bloom_view(Slice<byte> bytes, BloomFilter* out);
+
+//// Priority Queue
+// Min-heap (according to Cmp) with `Arity` children per node. Wider nodes make
+// the heap shallower and keep siblings in the same cache line, so sifting
+// touches fewer lines than a binary heap. Every element gets a handle that
+// stays valid until it is popped, which allows changing its priority.
+struct PriorityQueueHandle {
+	i32 id;
+};
+
+template<typename T, typename Cmp = Less<T>, int Arity = 4>
+struct PriorityQueue {
+	DynamicArray<T>   _items;     // Heap order
+	DynamicArray<i32> _handles;   // Heap position -> handle
+	DynamicArray<i32> _positions; // Handle -> heap position, or -2 - next free handle
+	i32               _free_handle;
+	Cmp               _less;
+
+	static_assert(Arity >= 2, "Heap arity must be at least 2");
+};
+
+namespace impl_priority_queue {
+	template<typename T, typename Cmp, int Arity>
+	void place(PriorityQueue<T, Cmp, Arity>* pq, isize pos, T const& item, i32 handle){
+		pq->_items._data[pos] = item;
+		pq->_handles._data[pos] = handle;
+		pq->_positions._data[handle] = i32(pos);
+	}
+
+	// Moves the hole at `pos` up until `item` fits, parents are shifted down
+	template<typename T, typename Cmp, int Arity>
+	void sift_up(PriorityQueue<T, Cmp, Arity>* pq, isize pos, T item, i32 handle){
+		T* items = pq->_items._data;
+		while(pos > 0){
+			isize parent = (pos - 1) / Arity;
+			if(!pq->_less(item, items[parent])){ break; }
+			place(pq, pos, items[parent], pq->_handles._data[parent]);
+			pos = parent;
+		}
+		place(pq, pos, item, handle);
+	}
+
+	// Moves the hole at `pos` down until `item` fits, the smallest child is
+	// shifted up at each level
+	template<typename T, typename Cmp, int Arity>
+	void sift_down(PriorityQueue<T, Cmp, Arity>* pq, isize pos, T item, i32 handle){
+		T* items = pq->_items._data;
+		isize n = pq->_items._length;
+		for(;;){
+			isize first = pos * Arity + 1;
+			if(first >= n){ break; }
+
+			isize best = first;
+			isize last = min(first + Arity, n);
+			for(isize c = first + 1; c < last; c += 1){
+				if(pq->_less(items[c], items[best])){ best = c; }
+			}
+			if(!pq->_less(items[best], item)){ break; }
+
+			place(pq, pos, items[best], pq->_handles._data[best]);
+			pos = best;
+		}
+		place(pq, pos, item, handle);
+	}
+
+	template<typename T, typename Cmp, int Arity>
+	Result<i32, AllocatorError> new_handle(PriorityQueue<T, Cmp, Arity>* pq){
+		if(pq->_free_handle >= 0){
+			i32 h = pq->_free_handle;
+			pq->_free_handle = -2 - pq->_positions._data[h];
+			return { h };
+		}
+		auto err = append(&pq->_positions, i32(-1));
+		if(!ok(err)){ return { -1, err }; }
+		return { i32(pq->_positions._length - 1) };
+	}
+
+	template<typename T, typename Cmp, int Arity>
+	void release_handle(PriorityQueue<T, Cmp, Arity>* pq, i32 h){
+		pq->_positions._data[h] = -2 - pq->_free_handle;
+		pq->_free_handle = h;
+	}
+}
+
+template<typename T, typename Cmp = Less<T>, int Arity = 4>
+PriorityQueue<T, Cmp, Arity> make_priority_queue(Allocator allocator, isize cap = dynamic_array_default_capacity, Cmp less = Cmp{}){
+	PriorityQueue<T, Cmp, Arity> pq;
+	pq._items = make_dynamic_array<T>(allocator, cap);
+	pq._handles = make_dynamic_array<i32>(allocator, cap);
+	pq._positions = make_dynamic_array<i32>(allocator, cap);
+	pq._free_handle = -1;
+	pq._less = less;
+	return pq;
+}
+
+template<typename T, typename Cmp, int Arity>
+void destroy(PriorityQueue<T, Cmp, Arity>* pq){
+	destroy(&pq->_items);
+	destroy(&pq->_handles);
+	destroy(&pq->_positions);
+}
+
+template<typename T, typename Cmp, int Arity>
+void clear(PriorityQueue<T, Cmp, Arity>* pq){
+	clear(&pq->_items);
+	clear(&pq->_handles);
+	clear(&pq->_positions);
+	pq->_free_handle = -1;
+}
+
+template<typename T, typename Cmp, int Arity> constexpr
+auto len(PriorityQueue<T, Cmp, Arity> const& pq){ return pq._items._length; }
+
+template<typename T, typename Cmp, int Arity>
+T const& top(PriorityQueue<T, Cmp, Arity> const& pq){
+	return pq._items[0];
+}
+
+template<typename T, typename Cmp, int Arity>
+Result<PriorityQueueHandle, AllocatorError> push(PriorityQueue<T, Cmp, Arity>* pq, T item){
+	auto [h, err] = impl_priority_queue::new_handle(pq);
+	if(!ok(err)){ return { {-1}, err }; }
+
+	err = append(&pq->_items, item);
+	if(ok(err)){
+		err = append(&pq->_handles, h);
+		if(!ok(err)){ pq->_items._length -= 1; }
+	}
+	if(!ok(err)){
+		impl_priority_queue::release_handle(pq, h);
+		return { {-1}, err };
+	}
+
+	impl_priority_queue::sift_up(pq, pq->_items._length - 1, item, h);
+	return { {h} };
+}
+
+// Removes the top element, copying it to `out` when not null.
+template<typename T, typename Cmp, int Arity>
+bool pop(PriorityQueue<T, Cmp, Arity>* pq, T* out = nullptr){
+	isize n = pq->_items._length;
+	if(n < 1){ return false; }
+
+	if(out){ *out = pq->_items._data[0]; }
+	impl_priority_queue::release_handle(pq, pq->_handles._data[0]);
+
+	n -= 1;
+	pq->_items._length = n;
+	pq->_handles._length = n;
+	if(n > 0){
+		impl_priority_queue::sift_down(pq, 0, pq->_items._data[n], pq->_handles._data[n]);
+	}
+	return true;
+}
+
+// Lower (according to Cmp) the priority of an element still in the queue.
+template<typename T, typename Cmp, int Arity>
+void decrease_key(PriorityQueue<T, Cmp, Arity>* pq, PriorityQueueHandle handle, T item){
+	bounds_check_assert(handle.id >= 0 && handle.id < pq->_positions._length, "Invalid priority queue handle");
+	i32 pos = pq->_positions._data[handle.id];
+	ensure(pos >= 0, "Priority queue handle is no longer in the queue");
+	ensure(!pq->_less(pq->_items._data[pos], item), "New key must not be greater than the current one");
+	impl_priority_queue::sift_up(pq, pos, item, handle.id);
+}
+
+// Replace the contents of the queue with `items` in O(n), handles are
+// assigned in slice order (items[i] gets handle i).
+template<typename T, typename Cmp, int Arity>
+AllocatorError heapify(PriorityQueue<T, Cmp, Arity>* pq, Slice<T> items){
+	clear(pq);
+	for(isize i = 0; i < len(items); i += 1){
+		auto err = append(&pq->_items, items[i]);
+		if(ok(err)){ err = append(&pq->_handles, i32(i)); }
+		if(ok(err)){ err = append(&pq->_positions, i32(i)); }
+		if(!ok(err)){
+			clear(pq);
+			return err;
+		}
+	}
+
+	isize n = len(items);
+	for(isize i = (n - 2) / Arity; n > 1 && i >= 0; i -= 1){
+		impl_priority_queue::sift_down(pq, i, pq->_items._data[i], pq->_handles._data[i]);
+	}
+	return {};
+}
+
+//// B-Tree Map
+// Ordered map stored as a B+ tree. Nodes are sized to a multiple of the cache
+// line, so each one holds as many keys as fit in `btree_node_lines` lines and
+// a lookup touches a handful of lines per level. Values live in the leaves,
+// which are linked in key order for range scans. All leaves and all inner
+// nodes share one size, which plays well with pool allocators.
+//
+// Removal does not rebalance: leaves may become underfull or empty, lookups
+// and iteration stay correct and a later bulk_load compacts the tree again.
+constexpr isize btree_node_lines = 4;
+
+namespace impl_btree {
+	struct Header {
+		i32  count;
+		bool leaf;
+	};
+
+	template<typename K, typename V>
+	struct Layout {
+		static constexpr isize node_size = cache_line_size * btree_node_lines;
+		static constexpr isize leaf_fit  = (node_size - isize(sizeof(Header)) - isize(sizeof(void*))) / isize(sizeof(K) + sizeof(V));
+		static constexpr isize inner_fit = (node_size - isize(sizeof(Header)) - isize(sizeof(void*))) / isize(sizeof(K) + sizeof(void*));
+		static constexpr isize leaf_cap  = leaf_fit  < 4 ? 4 : leaf_fit;
+		static constexpr isize inner_cap = inner_fit < 4 ? 4 : inner_fit;
+	};
+}
+
+template<typename K, typename V>
+struct alignas(cache_line_size) BTreeLeaf {
+	impl_btree::Header header;
+	BTreeLeaf* next;
+	K keys[impl_btree::Layout<K, V>::leaf_cap];
+	V values[impl_btree::Layout<K, V>::leaf_cap];
+};
+
+template<typename K, typename V>
+struct alignas(cache_line_size) BTreeInner {
+	impl_btree::Header header;
+	K keys[impl_btree::Layout<K, V>::inner_cap];
+	impl_btree::Header* children[impl_btree::Layout<K, V>::inner_cap + 1];
+};
+
+template<typename K, typename V, typename Cmp = Less<K>>
+struct BTreeMap {
+	impl_btree::Header* _root;
+	isize               _length;
+	i32                 _height; // 0 when empty, 1 when the root is a leaf
+	Allocator           _allocator;
+	Cmp                 _less;
+};
+
+template<typename K, typename V>
+struct BTreeIterator {
+	BTreeLeaf<K, V>* leaf;
+	isize idx;
+};
+
+template<typename K, typename V, typename Cmp> constexpr
+auto len(BTreeMap<K, V, Cmp> const& m){ return m._length; }
+
+template<typename K, typename V, typename Cmp = Less<K>>
+BTreeMap<K, V, Cmp> make_btree_map(Allocator allocator, Cmp less = Cmp{}){
+	BTreeMap<K, V, Cmp> m;
+	m._root = nullptr;
+	m._length = 0;
+	m._height = 0;
+	m._allocator = allocator;
+	m._less = less;
+	return m;
+}
+
+namespace impl_btree {
+	template<typename K, typename V, typename Cmp>
+	BTreeLeaf<K, V>* new_leaf(BTreeMap<K, V, Cmp>* m){
+		auto leaf = make<BTreeLeaf<K, V>>(m->_allocator);
+		if(leaf){
+			leaf->header = { 0, true };
+			leaf->next = nullptr;
+		}
+		return leaf;
+	}
+
+	template<typename K, typename V, typename Cmp>
+	BTreeInner<K, V>* new_inner(BTreeMap<K, V, Cmp>* m){
+		auto inner = make<BTreeInner<K, V>>(m->_allocator);
+		if(inner){
+			inner->header = { 0, false };
+		}
+		return inner;
+	}
+
+	template<typename K, typename V, typename Cmp>
+	void free_node(BTreeMap<K, V, Cmp>* m, Header* node){
+		if(node->leaf){
+			destroy((BTreeLeaf<K, V>*)node, m->_allocator);
+			return;
+		}
+		auto inner = (BTreeInner<K, V>*)node;
+		for(isize i = 0; i <= inner->header.count; i += 1){
+			free_node(m, inner->children[i]);
+		}
+		destroy(inner, m->_allocator);
+	}
+
+	// First position whose key is not less than `key`
+	template<typename K, typename Cmp>
+	isize lower_bound(K const* keys, isize n, K const& key, Cmp const& less){
+		isize lo = 0, hi = n;
+		while(lo < hi){
+			isize mid = (lo + hi) / 2;
+			if(less(keys[mid], key)){ lo = mid + 1; }
+			else { hi = mid; }
+		}
+		return lo;
+	}
+
+	// First position whose key is greater than `key`
+	template<typename K, typename Cmp>
+	isize upper_bound(K const* keys, isize n, K const& key, Cmp const& less){
+		isize lo = 0, hi = n;
+		while(lo < hi){
+			isize mid = (lo + hi) / 2;
+			if(less(key, keys[mid])){ hi = mid; }
+			else { lo = mid + 1; }
+		}
+		return lo;
+	}
+
+	template<typename K, typename V, typename Cmp>
+	BTreeLeaf<K, V>* find_leaf(BTreeMap<K, V, Cmp> const* m, K const& key){
+		Header* node = m->_root;
+		if(!node){ return nullptr; }
+		while(!node->leaf){
+			auto inner = (BTreeInner<K, V>*)node;
+			node = inner->children[upper_bound(inner->keys, inner->header.count, key, m->_less)];
+		}
+		return (BTreeLeaf<K, V>*)node;
+	}
+
+	template<typename K>
+	struct Split {
+		Header* right; // nullptr when the node did not split
+		K separator;   // Smallest key in `right`
+		AllocatorError error;
+		bool inserted; // False when an existing key was overwritten
+	};
+
+	template<typename K, typename V, typename Cmp>
+	Split<K> insert_leaf(BTreeMap<K, V, Cmp>* m, BTreeLeaf<K, V>* leaf, K const& key, V const& value){
+		constexpr isize cap = Layout<K, V>::leaf_cap;
+		isize n = leaf->header.count;
+		isize pos = lower_bound(leaf->keys, n, key, m->_less);
+
+		if(pos < n && !m->_less(key, leaf->keys[pos])){
+			leaf->values[pos] = value;
+			return { nullptr, {}, {}, false };
+		}
+
+		if(n < cap){
+			for(isize i = n; i > pos; i -= 1){
+				leaf->keys[i] = leaf->keys[i - 1];
+				leaf->values[i] = leaf->values[i - 1];
+			}
+			leaf->keys[pos] = key;
+			leaf->values[pos] = value;
+			leaf->header.count += 1;
+			return { nullptr, {}, {}, true };
+		}
+
+		auto right = new_leaf(m);
+		if(!right){ return { nullptr, {}, AllocatorError::OutOfMemory, false }; }
+
+		// Split the cap + 1 entries evenly, the new one included
+		isize left_count = (cap + 1) / 2;
+		isize total = cap + 1;
+		for(isize dst = total - 1, src = n - 1; dst >= left_count; dst -= 1){
+			BTreeLeaf<K, V>* target = right;
+			isize at = dst - left_count;
+			if(dst == pos){
+				target->keys[at] = key;
+				target->values[at] = value;
+			}
+			else {
+				target->keys[at] = leaf->keys[src];
+				target->values[at] = leaf->values[src];
+				src -= 1;
+			}
+		}
+		if(pos < left_count){
+			for(isize i = left_count - 1; i > pos; i -= 1){
+				leaf->keys[i] = leaf->keys[i - 1];
+				leaf->values[i] = leaf->values[i - 1];
+			}
+			leaf->keys[pos] = key;
+			leaf->values[pos] = value;
+		}
+		leaf->header.count = i32(left_count);
+		right->header.count = i32(total - left_count);
+
+		right->next = leaf->next;
+		leaf->next = right;
+		return { (Header*)right, right->keys[0], {}, true };
+	}
+
+	template<typename K, typename V, typename Cmp>
+	Split<K> insert_rec(BTreeMap<K, V, Cmp>* m, Header* node, K const& key, V const& value){
+		if(node->leaf){
+			return insert_leaf(m, (BTreeLeaf<K, V>*)node, key, value);
+		}
+
+		constexpr isize cap = Layout<K, V>::inner_cap;
+		auto inner = (BTreeInner<K, V>*)node;
+		isize n = inner->header.count;
+		isize pos = upper_bound(inner->keys, n, key, m->_less);
+
+		// Allocate the split target up front so a failure leaves the tree untouched
+		BTreeInner<K, V>* right = nullptr;
+		if(n == cap){
+			right = new_inner(m);
+			if(!right){ return { nullptr, {}, AllocatorError::OutOfMemory, false }; }
+		}
+
+		auto child = insert_rec(m, inner->children[pos], key, value);
+		if(!child.right){
+			if(right){ destroy(right, m->_allocator); }
+			return child;
+		}
+
+		if(n < cap){
+			for(isize i = n; i > pos; i -= 1){
+				inner->keys[i] = inner->keys[i - 1];
+				inner->children[i + 1] = inner->children[i];
+			}
+			inner->keys[pos] = child.separator;
+			inner->children[pos + 1] = child.right;
+			inner->header.count += 1;
+			return { nullptr, {}, {}, true };
+		}
+
+		// Gather the cap + 1 keys and cap + 2 children, then split around the middle key
+		K keys[cap + 1];
+		Header* children[cap + 2];
+		for(isize i = 0, k = 0; i <= n; i += 1){
+			if(i == pos){
+				keys[k] = child.separator;
+				k += 1;
+			}
+			if(i < n){
+				keys[k] = inner->keys[i];
+				k += 1;
+			}
+		}
+		for(isize i = 0, c = 0; i <= n; i += 1){
+			children[c] = inner->children[i];
+			c += 1;
+			if(i == pos){
+				children[c] = child.right;
+				c += 1;
+			}
+		}
+
+		isize mid = (cap + 1) / 2;
+		inner->header.count = i32(mid);
+		for(isize i = 0; i < mid; i += 1){
+			inner->keys[i] = keys[i];
+			inner->children[i] = children[i];
+		}
+		inner->children[mid] = children[mid];
+
+		isize right_count = cap - mid;
+		right->header.count = i32(right_count);
+		for(isize i = 0; i < right_count; i += 1){
+			right->keys[i] = keys[mid + 1 + i];
+			right->children[i] = children[mid + 1 + i];
+		}
+		right->children[right_count] = children[cap + 1];
+
+		return { (Header*)right, keys[mid], {}, true };
+	}
+
+	// Skip past the end of the current leaf (and over empty leaves)
+	template<typename K, typename V>
+	void normalize(BTreeIterator<K, V>* it){
+		while(it->leaf && it->idx >= it->leaf->header.count){
+			it->leaf = it->leaf->next;
+			it->idx = 0;
+		}
+	}
+}
+
+template<typename K, typename V, typename Cmp>
+void destroy(BTreeMap<K, V, Cmp>* m){
+	if(m->_root){
+		impl_btree::free_node(m, m->_root);
+	}
+	m->_root = nullptr;
+	m->_length = 0;
+	m->_height = 0;
+}
+
+template<typename K, typename V, typename Cmp>
+V* find(BTreeMap<K, V, Cmp>* m, K key){
+	auto leaf = impl_btree::find_leaf(m, key);
+	if(!leaf){ return nullptr; }
+	isize pos = impl_btree::lower_bound(leaf->keys, leaf->header.count, key, m->_less);
+	if(pos < leaf->header.count && !m->_less(key, leaf->keys[pos])){
+		return &leaf->values[pos];
+	}
+	return nullptr;
+}
+
+// Insert or overwrite the value associated with key
+template<typename K, typename V, typename Cmp>
+AllocatorError insert(BTreeMap<K, V, Cmp>* m, K key, V value){
+	if(!m->_root){
+		auto leaf = impl_btree::new_leaf(m);
+		if(!leaf){ return AllocatorError::OutOfMemory; }
+		m->_root = (impl_btree::Header*)leaf;
+		m->_height = 1;
+	}
+
+	impl_btree::Header* old_root = m->_root;
+	bool root_full = old_root->leaf
+		? old_root->count == impl_btree::Layout<K, V>::leaf_cap
+		: old_root->count == impl_btree::Layout<K, V>::inner_cap;
+	BTreeInner<K, V>* root = nullptr;
+	if(root_full){
+		root = impl_btree::new_inner(m);
+		if(!root){ return AllocatorError::OutOfMemory; }
+	}
+
+	auto split = impl_btree::insert_rec(m, m->_root, key, value);
+	if(!ok(split.error) || !split.right){
+		if(root){ destroy(root, m->_allocator); }
+	}
+	if(!ok(split.error)){ return split.error; }
+	if(split.inserted){ m->_length += 1; }
+
+	if(split.right){
+		root->header.count = 1;
+		root->keys[0] = split.separator;
+		root->children[0] = m->_root;
+		root->children[1] = split.right;
+		m->_root = (impl_btree::Header*)root;
+		m->_height += 1;
+	}
+	return {};
+}
+
+template<typename K, typename V, typename Cmp>
+bool remove(BTreeMap<K, V, Cmp>* m, K key){
+	auto leaf = impl_btree::find_leaf(m, key);
+	if(!leaf){ return false; }
+	isize n = leaf->header.count;
+	isize pos = impl_btree::lower_bound(leaf->keys, n, key, m->_less);
+	if(pos >= n || m->_less(key, leaf->keys[pos])){ return false; }
+
+	for(isize i = pos; i < n - 1; i += 1){
+		leaf->keys[i] = leaf->keys[i + 1];
+		leaf->values[i] = leaf->values[i + 1];
+	}
+	leaf->header.count -= 1;
+	m->_length -= 1;
+	return true;
+}
+
+// Iterator to the first element whose key is not less than `key`
+template<typename K, typename V, typename Cmp>
+BTreeIterator<K, V> lower_bound(BTreeMap<K, V, Cmp>* m, K key){
+	BTreeIterator<K, V> it = { impl_btree::find_leaf(m, key), 0 };
+	if(it.leaf){
+		it.idx = impl_btree::lower_bound(it.leaf->keys, it.leaf->header.count, key, m->_less);
+	}
+	impl_btree::normalize(&it);
+	return it;
+}
+
+// Iterator to the smallest key
+template<typename K, typename V, typename Cmp>
+BTreeIterator<K, V> first(BTreeMap<K, V, Cmp>* m){
+	impl_btree::Header* node = m->_root;
+	while(node && !node->leaf){
+		node = ((BTreeInner<K, V>*)node)->children[0];
+	}
+	BTreeIterator<K, V> it = { (BTreeLeaf<K, V>*)node, 0 };
+	impl_btree::normalize(&it);
+	return it;
+}
+
+template<typename K, typename V>
+bool iter_done(BTreeIterator<K, V>* it){
+	return it->leaf == nullptr;
+}
+
+template<typename K, typename V>
+void iter_advance(BTreeIterator<K, V>* it){
+	it->idx += 1;
+	impl_btree::normalize(it);
+}
+
+template<typename K, typename V>
+K const& key(BTreeIterator<K, V> const& it){
+	return it.leaf->keys[it.idx];
+}
+
+template<typename K, typename V>
+V& value(BTreeIterator<K, V> const& it){
+	return it.leaf->values[it.idx];
+}
+
+// Calls f(key, value) for every element with lo <= key < hi, in order
+template<typename K, typename V, typename Cmp, typename F>
+void for_each_in_range(BTreeMap<K, V, Cmp>* m, K lo, K hi, F&& f){
+	for(auto it = lower_bound(m, lo); !iter_done(&it); iter_advance(&it)){
+		if(!m->_less(key(it), hi)){ break; }
+		f(key(it), value(it));
+	}
+}
+
+// Build the tree bottom up from strictly ascending keys, replacing whatever
+// was in it. Nodes come out full (balanced within one entry of each other).
+template<typename K, typename V, typename Cmp>
+AllocatorError bulk_load(BTreeMap<K, V, Cmp>* m, Slice<K> keys, Slice<V> values){
+	using namespace impl_btree;
+	ensure(len(keys) == len(values), "Mismatched key and value counts");
+	destroy(m);
+
+	isize n = len(keys);
+	if(n == 0){ return {}; }
+
+	constexpr isize leaf_cap = Layout<K, V>::leaf_cap;
+	constexpr isize inner_cap = Layout<K, V>::inner_cap;
+
+	// Each level is kept as (node, smallest key) pairs
+	auto level = make_dynamic_array<Pair<Header*, K>>(m->_allocator, (n + leaf_cap - 1) / leaf_cap);
+	defer(destroy(&level));
+	auto next_level = make_dynamic_array<Pair<Header*, K>>(m->_allocator, (len(level) + inner_cap) / (inner_cap + 1) + 1);
+	defer(destroy(&next_level));
+
+	AllocatorError err = {};
+
+	isize leaf_count = (n + leaf_cap - 1) / leaf_cap;
+	BTreeLeaf<K, V>* prev = nullptr;
+	for(isize i = 0, start = 0; i < leaf_count; i += 1){
+		isize count = (n - start) / (leaf_count - i);
+		auto leaf = new_leaf(m);
+		if(!leaf){ err = AllocatorError::OutOfMemory; break; }
+		for(isize j = 0; j < count; j += 1){
+			if(j > 0 || start > 0){
+				ensure(m->_less(keys[start + j - 1], keys[start + j]), "Keys for bulk_load must be strictly ascending");
+			}
+			leaf->keys[j] = keys[start + j];
+			leaf->values[j] = values[start + j];
+		}
+		leaf->header.count = i32(count);
+		if(prev){ prev->next = leaf; }
+		else { m->_root = (Header*)leaf; } // Keeps the chain reachable for cleanup on failure
+		prev = leaf;
+		err = append(&level, Pair<Header*, K>{ (Header*)leaf, keys[start] });
+		if(!ok(err)){ break; }
+		start += count;
+	}
+
+	if(!ok(err)){
+		// Only leaves exist so far, free them through the chain
+		for(auto leaf = (BTreeLeaf<K, V>*)m->_root; leaf;){
+			auto next = leaf->next;
+			destroy(leaf, m->_allocator);
+			leaf = next;
+		}
+		m->_root = nullptr;
+		return err;
+	}
+	m->_root = nullptr;
+
+	i32 height = 1;
+	while(len(level) > 1){
+		isize child_count = len(level);
+		isize node_count = (child_count + inner_cap) / (inner_cap + 1);
+		clear(&next_level);
+		isize start = 0;
+		for(isize i = 0; i < node_count; i += 1){
+			isize count = (child_count - start) / (node_count - i);
+			auto inner = new_inner(m);
+			if(!inner){ err = AllocatorError::OutOfMemory; break; }
+			for(isize j = 0; j < count; j += 1){
+				inner->children[j] = level[start + j].a;
+				if(j > 0){ inner->keys[j - 1] = level[start + j].b; }
+			}
+			inner->header.count = i32(count - 1);
+			start += count;
+			err = append(&next_level, Pair<Header*, K>{ (Header*)inner, level[start - count].b });
+			if(!ok(err)){
+				free_node(m, (Header*)inner);
+				break;
+			}
+		}
+		if(!ok(err)){
+			// Every subtree is owned either by the new level or the unconsumed tail of the old one
+			for(isize i = 0; i < len(next_level); i += 1){ free_node(m, next_level[i].a); }
+			for(isize i = start; i < child_count; i += 1){ free_node(m, level[i].a); }
+			return err;
+		}
+		auto tmp = level;
+		level = next_level;
+		next_level = tmp;
+		height += 1;
+	}
+
+	m->_root = level[0].a;
+	m->_height = height;
+	m->_length = n;
+	return {};
+}
+
+//// Sorting
+// LSD radix sort, stable. Keys are mapped to unsigned integers that order the
+// same way (sign bit flipped for signed integers, all bits flipped for
+// negative floats), then sorted one byte per pass. Passes where every key has
+// the same byte are skipped, so narrow key ranges only pay for the bytes that
+// differ. Scratch memory of the same size as the input comes from `scratch`.
+namespace impl_radix {
+	constexpr isize insertion_threshold = 64;
+
+	inline u32 key_bits(u32 v){ return v; }
+	inline u64 key_bits(u64 v){ return v; }
+	inline u32 key_bits(i32 v){ return u32(v) ^ (u32(1) << 31); }
+	inline u64 key_bits(i64 v){ return u64(v) ^ (u64(1) << 63); }
+
+	inline u32 key_bits(f32 v){
+		u32 b; __builtin_memcpy(&b, &v, sizeof(b));
+		u32 mask = u32(-i32(b >> 31)) | (u32(1) << 31);
+		return b ^ mask;
+	}
+
+	inline u64 key_bits(f64 v){
+		u64 b; __builtin_memcpy(&b, &v, sizeof(b));
+		u64 mask = u64(-i64(b >> 63)) | (u64(1) << 63);
+		return b ^ mask;
+	}
+
+	template<typename T, typename KeyFn>
+	void insertion_sort(T* data, isize n, KeyFn& key){
+		for(isize i = 1; i < n; i += 1){
+			T item = data[i];
+			auto k = key_bits(key(item));
+			isize j = i;
+			for(; j > 0 && k < key_bits(key(data[j - 1])); j -= 1){
+				data[j] = data[j - 1];
+			}
+			data[j] = item;
+		}
+	}
+
+	template<typename T, typename KeyFn>
+	AllocatorError sort(Slice<T> s, Allocator scratch, KeyFn& key){
+		using U = decltype(key_bits(key(s[0])));
+		constexpr isize passes = sizeof(U);
+		isize n = len(s);
+		T* data = raw_data(s);
+
+		if(n < insertion_threshold){
+			insertion_sort(data, n, key);
+			return {};
+		}
+
+		// All histograms in a single read of the input
+		isize counts[passes][256] = {};
+		for(isize i = 0; i < n; i += 1){
+			U k = key_bits(key(data[i]));
+			for(isize p = 0; p < passes; p += 1){
+				counts[p][(k >> (p * 8)) & 0xff] += 1;
+			}
+		}
+
+		auto [buf, err] = mem_alloc(scratch, n * isize(sizeof(T)), alignof(T));
+		if(!buf){ return err; }
+		T* src = data;
+		T* dst = (T*)buf;
+
+		for(isize p = 0; p < passes; p += 1){
+			isize* c = counts[p];
+			if(c[(key_bits(key(src[0])) >> (p * 8)) & 0xff] == n){ continue; }
+
+			isize offsets[256];
+			isize sum = 0;
+			for(isize b = 0; b < 256; b += 1){
+				offsets[b] = sum;
+				sum += c[b];
+			}
+			for(isize i = 0; i < n; i += 1){
+				U k = key_bits(key(src[i]));
+				dst[offsets[(k >> (p * 8)) & 0xff]++] = src[i];
+			}
+
+			T* tmp = src;
+			src = dst;
+			dst = tmp;
+		}
+
+		if(src != data){
+			mem_copy(data, src, n * isize(sizeof(T)));
+		}
+		mem_free(scratch, buf, n * isize(sizeof(T)), alignof(T));
+		return {};
+	}
+}
+
+AllocatorError radix_sort(Slice<u32> s, Allocator scratch);
+AllocatorError radix_sort(Slice<u64> s, Allocator scratch);
+AllocatorError radix_sort(Slice<i32> s, Allocator scratch);
+AllocatorError radix_sort(Slice<i64> s, Allocator scratch);
+AllocatorError radix_sort(Slice<f32> s, Allocator scratch);
+AllocatorError radix_sort(Slice<f64> s, Allocator scratch);
+
+// Sort records by key(record), which must return one of the key types above
+template<typename T, typename KeyFn>
+AllocatorError radix_sort(Slice<T> s, Allocator scratch, KeyFn key){
+	return impl_radix::sort(s, scratch, key);
+}
+
+// Introsort: quicksort with median of 3 pivots, falling back to heapsort when
+// recursion gets too deep and to insertion sort for short ranges. Not stable.
+namespace impl_sort {
+	constexpr isize insertion_threshold = 24;
+
+	template<typename T, typename Cmp>
+	void insertion_sort(T* data, isize n, Cmp& less){
+		for(isize i = 1; i < n; i += 1){
+			T item = data[i];
+			isize j = i;
+			for(; j > 0 && less(item, data[j - 1]); j -= 1){
+				data[j] = data[j - 1];
+			}
+			data[j] = item;
+		}
+	}
+
+	template<typename T, typename Cmp>
+	void sift_down(T* data, isize pos, isize n, Cmp& less){
+		T item = data[pos];
+		for(;;){
+			isize child = pos * 2 + 1;
+			if(child >= n){ break; }
+			if(child + 1 < n && less(data[child], data[child + 1])){ child += 1; }
+			if(!less(item, data[child])){ break; }
+			data[pos] = data[child];
+			pos = child;
+		}
+		data[pos] = item;
+	}
+
+	template<typename T, typename Cmp>
+	void heap_sort(T* data, isize n, Cmp& less){
+		for(isize i = n / 2 - 1; i >= 0; i -= 1){
+			sift_down(data, i, n, less);
+		}
+		for(isize i = n - 1; i > 0; i -= 1){
+			swap(&data[0], &data[i]);
+			sift_down(data, 0, i, less);
+		}
+	}
+
+	template<typename T, typename Cmp>
+	void introsort(T* data, isize n, isize depth, Cmp& less){
+		while(n > insertion_threshold){
+			if(depth == 0){
+				heap_sort(data, n, less);
+				return;
+			}
+			depth -= 1;
+
+			// Median of 3 ends up at data[0], data[1] and data[n - 1] bound the partition scans
+			isize mid = n / 2;
+			if(less(data[mid], data[0])){ swap(&data[mid], &data[0]); }
+			if(less(data[n - 1], data[mid])){ swap(&data[n - 1], &data[mid]); }
+			if(less(data[mid], data[0])){ swap(&data[mid], &data[0]); }
+			swap(&data[0], &data[mid]);
+			swap(&data[1], &data[mid]);
+			if(less(data[0], data[1])){ swap(&data[0], &data[1]); }
+
+			T pivot = data[0];
+			isize i = 1, j = n - 1;
+			for(;;){
+				do { i += 1; } while(less(data[i], pivot));
+				do { j -= 1; } while(less(pivot, data[j]));
+				if(i >= j){ break; }
+				swap(&data[i], &data[j]);
+			}
+			swap(&data[0], &data[j]);
+
+			// Recurse into the smaller side, loop on the larger one
+			if(j < n - j - 1){
+				introsort(data, j, depth, less);
+				data += j + 1;
+				n -= j + 1;
+			}
+			else {
+				introsort(data + j + 1, n - j - 1, depth, less);
+				n = j;
+			}
+		}
+		insertion_sort(data, n, less);
+	}
+}
+
+template<typename T, typename Cmp = Less<T>>
+void sort(Slice<T> s, Cmp less = Cmp{}){
+	isize n = len(s);
+	if(n < 2){ return; }
+	isize depth = 2 * (64 - __builtin_clzll(u64(n)));
+	impl_sort::introsort(raw_data(s), n, depth, less);
+}
+
+// Parallel sort: the slice is cut into one run per thread (the caller
+// included), runs are sorted concurrently, then merged pairwise. Every merge
+// round is split into as many independent tasks as there are runs by cutting
+// the output along merge paths, so all threads stay busy until the last
+// round. Needs scratch memory of the same size as the input. Not stable.
+namespace impl_parallel_sort {
+	constexpr isize sequential_threshold = 1 << 14;
+	constexpr isize min_run_length = 1 << 12;
+
+	template<typename T, typename Cmp>
+	struct Context {
+		T*    src;
+		T*    dst;
+		isize length;
+		isize runs;
+		isize base_width; // Length of the initial runs
+		isize width;      // Length of the sorted runs in src
+		Cmp   less;
+	};
+
+	template<typename T, typename Cmp>
+	struct TaskArg {
+		Context<T, Cmp>* ctx;
+		isize index;
+	};
+
+	template<typename T, typename Cmp>
+	void sort_run(void* data){
+		auto arg = (TaskArg<T, Cmp>*)data;
+		auto ctx = arg->ctx;
+		isize lo = min(arg->index * ctx->width, ctx->length);
+		isize hi = min(lo + ctx->width, ctx->length);
+		sort(Slice<T>(ctx->src + lo, hi - lo), ctx->less);
+	}
+
+	// Number of elements taken from `a` among the first `diag` outputs of a
+	// stable merge of a and b
+	template<typename T, typename Cmp>
+	isize merge_path(T const* a, isize na, T const* b, isize nb, isize diag, Cmp& less){
+		isize lo = max(isize(0), diag - nb);
+		isize hi = min(diag, na);
+		while(lo < hi){
+			isize i = (lo + hi) / 2;
+			if(!less(b[diag - i - 1], a[i])){ lo = i + 1; }
+			else { hi = i; }
+		}
+		return lo;
+	}
+
+	template<typename T, typename Cmp>
+	void merge_part(void* data){
+		auto arg = (TaskArg<T, Cmp>*)data;
+		auto ctx = arg->ctx;
+		isize w = ctx->width;
+		isize parts = 2 * w / ctx->base_width; // Tasks per pair of runs
+		isize pair = arg->index / parts;
+		isize part = arg->index % parts;
+
+		isize lo = min(pair * 2 * w, ctx->length);
+		isize mid = min(lo + w, ctx->length);
+		isize hi = min(mid + w, ctx->length);
+		T const* a = ctx->src + lo;
+		T const* b = ctx->src + mid;
+		isize na = mid - lo, nb = hi - mid;
+
+		isize d0 = (na + nb) * part / parts;
+		isize d1 = (na + nb) * (part + 1) / parts;
+		isize i = merge_path(a, na, b, nb, d0, ctx->less);
+		isize j = d0 - i;
+		isize i_end = merge_path(a, na, b, nb, d1, ctx->less);
+		isize j_end = d1 - i_end;
+
+		T* out = ctx->dst + lo + d0;
+		while(i < i_end && j < j_end){
+			if(ctx->less(b[j], a[i])){ *out = b[j]; j += 1; }
+			else { *out = a[i]; i += 1; }
+			out += 1;
+		}
+		for(; i < i_end; i += 1){ *out = a[i]; out += 1; }
+		for(; j < j_end; j += 1){ *out = b[j]; out += 1; }
+	}
+
+	template<typename T, typename Cmp>
+	void copy_part(void* data){
+		auto arg = (TaskArg<T, Cmp>*)data;
+		auto ctx = arg->ctx;
+		isize lo = ctx->length * arg->index / ctx->runs;
+		isize hi = ctx->length * (arg->index + 1) / ctx->runs;
+		mem_copy(ctx->dst + lo, ctx->src + lo, (hi - lo) * isize(sizeof(T)));
+	}
+
+	template<typename T, typename Cmp>
+	void run_tasks(ThreadPool* pool, Slice<TaskArg<T, Cmp>> args, ThreadPoolFunc func){
+		WaitGroup group;
+		for(isize i = 0; i < len(args); i += 1){
+			thread_pool_submit(pool, func, &args[i], &group);
+		}
+		thread_pool_wait(pool, &group);
+	}
+}
+
+template<typename T, typename Cmp>
+AllocatorError parallel_sort(Slice<T> s, Cmp less, ThreadPool* pool, Allocator scratch){
+	using namespace impl_parallel_sort;
+	isize n = len(s);
+
+	isize runs = 1;
+	while(pool && runs < thread_count(*pool) + 1){ runs *= 2; }
+	while(runs > 1 && n / runs < min_run_length){ runs /= 2; }
+
+	if(n < sequential_threshold || runs < 2){
+		sort(s, less);
+		return {};
+	}
+
+	auto buf = make<T>(n, scratch);
+	if(len(buf) == 0){ return AllocatorError::OutOfMemory; }
+	auto args = make<TaskArg<T, Cmp>>(runs, scratch);
+	if(len(args) == 0){
+		destroy(buf, scratch);
+		return AllocatorError::OutOfMemory;
+	}
+
+	Context<T, Cmp> ctx = {
+		.src = raw_data(s),
+		.dst = raw_data(buf),
+		.length = n,
+		.runs = runs,
+		.base_width = (n + runs - 1) / runs,
+		.width = (n + runs - 1) / runs,
+		.less = less,
+	};
+	for(isize i = 0; i < runs; i += 1){
+		args[i] = { &ctx, i };
+	}
+
+	run_tasks(pool, args, sort_run<T, Cmp>);
+
+	while(ctx.width < n){
+		run_tasks(pool, args, merge_part<T, Cmp>);
+		swap(&ctx.src, &ctx.dst);
+		ctx.width *= 2;
+	}
+
+	if(ctx.src != raw_data(s)){
+		ctx.dst = raw_data(s);
+		run_tasks(pool, args, copy_part<T, Cmp>);
+	}
+
+	destroy(args, scratch);
+	destroy(buf, scratch);
+	return {};
+}
+
+//// Array
+template<typename T, int N>
+struct Array {
+	T v[N];
+
+	T& operator[](isize idx){
+		bounds_check_assert(idx >= 0 && idx < N, "Index to slice is out of bounds");
+		return v[idx];
+	}
+
+	T const& operator[](isize idx) const {
+		bounds_check_assert(idx >= 0 && idx < N, "Index to slice is out of bounds");
+		return v[idx];
+	}
+
+	static_assert(N >= 0, "Array length must be greater than 0");
+};
+
+template<typename T, int N> constexpr
+isize len(Array<T, N>){ return N; }
+
+namespace impl_array {
+template<int Size> struct MaskOfSize {
+	static_assert(Size < 0, "Array comparisons need elements of 1, 2, 4 or 8 bytes");
+	using Type = void;
+};
+template<> struct MaskOfSize<1> { using Type = i8; };
+template<> struct MaskOfSize<2> { using Type = i16; };
+template<> struct MaskOfSize<4> { using Type = i32; };
+template<> struct MaskOfSize<8> { using Type = i64; };
+}
+
+// Comparisons on Array produce one mask lane per element, with all bits set
+// where the comparison holds and zero elsewhere, same as vector compares do.
+template<typename T>
+using ArrayMask = typename impl_array::MaskOfSize<sizeof(T)>::Type;
+
+template<typename M, int N>
+bool any(Array<M, N> mask){
+	M acc = 0;
+	for(int i = 0; i < N; i++){ acc |= mask.v[i]; }
+	return acc != 0;
+}
+
+template<typename M, int N>
+bool all(Array<M, N> mask){
+	M acc = M(-1);
+	for(int i = 0; i < N; i++){ acc &= mask.v[i]; }
+	return acc == M(-1);
+}
+
+// Packs the top bit of each lane into an integer, lane 0 being the lowest bit
+template<typename M, int N>
+u64 movemask(Array<M, N> mask){
+	static_assert(N <= 64, "Mask does not fit in 64 bits");
+	u64 bits = 0;
+	for(int i = 0; i < N; i++){ bits |= u64(mask.v[i] < 0) << i; }
+	return bits;
+}
+
+// Bitwise blend, takes the bits of a[i] where mask[i] is set and the bits of
+// b[i] elsewhere, same as the SIMD specializations.
+template<typename T, int N>
+Array<T, N> select(Array<ArrayMask<T>, N> mask, Array<T, N> a, Array<T, N> b){
+	using M = ArrayMask<T>;
+	Array<T, N> r;
+	for(int i = 0; i < N; i++){
+		M x, y;
+		__builtin_memcpy(&x, &a.v[i], sizeof(M));
+		__builtin_memcpy(&y, &b.v[i], sizeof(M));
+		M z = M((mask.v[i] & x) | (~mask.v[i] & y));
+		__builtin_memcpy(&r.v[i], &z, sizeof(M));
+	}
+	return r;
+}
+
+#include "internal_array_overloads.gen.cpp"
+
+//// UTF-8
+struct UTF8DecodeResult {
+	rune codepoint;
+	i32 size;
+};
+
+struct UTF8EncodeResult {
+	Array<byte, 4> data;
+	i32 size;
+};
+
+static inline
+bool utf8_is_continuation(rune c){
+	static const rune CONTINUATION1 = 0x80;
+	static const rune CONTINUATION2 = 0xbf;
+	return (c >= CONTINUATION1) && (c <= CONTINUATION2);
+}
+
+
+UTF8EncodeResult utf8_encode(rune r);
+
+UTF8DecodeResult utf8_decode(Slice<byte> s);
+
+struct UTF8Iterator {
+	Slice<byte> data;
+	isize current;
+
+	// WARNING: C++ Iterator insanity. C++ has some of the most shit
+	// iterator design in any programming language and it should not be
+	// taken seriously. This is *ONLY* to be able to iterate strings nicely.
+	void operator++(){
+		this->current += 1;
+		while(this->current < len(this->data) && utf8_is_continuation(this->data._data[this->current])){
+			this->current += 1;
+		}
+	}
+	void operator--(){
+		this->current -= 1;
+		while(this->current > 0 && utf8_is_continuation(this->data._data[this->current])){
+			this->current -= 1;
+		}
+	}
+	rune operator*(){
+		return utf8_decode(this->data[ {this->current, len(this->data)} ]).codepoint;
+	}
+	bool operator!=(UTF8Iterator const& it){
+		return &raw_data(this->data)[this->current] != &raw_data(it.data)[it.current];
+	}
+	UTF8Iterator begin(){ return {data, 0}; }
+	UTF8Iterator end(){ return {data, len(data)}; }
+};
+
+constexpr rune ERROR_RUNE = 0xfffd;
+
+constexpr UTF8EncodeResult ERROR_RUNE_UTF8 = {
+	.data = {0xef, 0xbf, 0xbd},
+	.size = 0,
+};
+
+bool iter_done(UTF8Iterator* it);
+
+UTF8DecodeResult iter_advance(UTF8Iterator* it);
+
+UTF8DecodeResult iter_rewind(UTF8Iterator* it);
+
+//// Strings
+static inline
+isize cstring_len(char const* cstr){
+	isize size = 0;
+	for(isize i = 0; cstr[i] != 0; i += 1){
+		size += 1;
+	}
+	return size;
+}
+
+struct String {
+	byte const* _data;
+	isize _length;
+
+	String() : _data{0}, _length{0} {}
+	String(const char* cs) : _data{(byte const*)cs}, _length{cstring_len(cs)}{}
+	explicit String(byte const* p, isize n) : _data{p}, _length{n}{}
+	explicit String(Slice<byte> s) : _data{raw_data(s)}, _length{len(s)}{}
+
+	byte operator[](isize idx){
+		bounds_check_assert(idx >= 0 && idx < _length, "Index to string is out of bounds");
+		return _data[idx];
+	}
+
+	String operator[](Pair<isize> range) const noexcept {
+		isize from = range.a;
+		isize to   = range.b;
+		bounds_check_assert(from >= 0 && from < _length && to >= 0 && to <= _length && from <= to, "Index to sub-string is out of bounds");
+
+		return String(&_data[from], to - from);
+	}
+
+	bool operator==(String lhs) const noexcept {
+		if(lhs._length != _length){ return false; }
+		return mem_compare(_data, lhs._data, _length) == 0;
+	}
+
+	bool operator!=(String lhs) const noexcept {
+		if(lhs._length != _length){ return true; }
+		return mem_compare(_data, lhs._data, _length) != 0;
+	}
+
+	// Bytewise lexicographic order, also UTF-8 codepoint order
+	bool operator<(String rhs) const noexcept {
+		isize n = _length < rhs._length ? _length : rhs._length;
+		i32 cmp = n > 0 ? mem_compare(_data, rhs._data, n) : 0;
+		return cmp < 0 || (cmp == 0 && _length < rhs._length);
+	}
+
+	// C++ Iterator bs
+
+	UTF8Iterator begin(){ return {Slice((byte*)_data, _length), 0}; }
+	UTF8Iterator end(){ return {Slice((byte*)_data, _length), _length}; }
+};
+
+static inline
+isize len(String s){ return s._length; }
+
+static inline
+byte const* raw_data(String s){ return s._data; }
+
+String str_clone(String s, Allocator a);
+
+String str_concat(String s0, String s1, Allocator a);
+
+isize str_rune_count(String s);
+
+bool str_starts_with(String s, String prefix);
+
+bool str_ends_with(String s, String suffix);
 
 // String str_trim(String s, String cutset) ;
 //
@@ -598,7 +3001,1804 @@ bool str_ends_with(String s, String suffix);
 //
 // String str_trim_trailing(String s, String cutset) ;
 
-isize str_find(String s, String pattern, isize start);
+isize str_find(String s, String pattern, isize start);
+
+//// Hashing
+u64 hash_bytes(void const* data, isize count, u64 seed = 0);
+
+static inline
+u64 hash_mix(u64 a, u64 b){
+	__uint128_t r = __uint128_t(a) * __uint128_t(b);
+	return u64(r) ^ u64(r >> 64);
+}
+
+static inline u64 hash(u64 v){ return hash_mix(v ^ 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull); }
+static inline u64 hash(i64 v){ return hash(u64(v)); }
+static inline u64 hash(u32 v){ return hash(u64(v)); }
+static inline u64 hash(i32 v){ return hash(u64(u32(v))); }
+static inline u64 hash(String s){ return hash_bytes(raw_data(s), len(s)); }
+
+template<typename T>
+u64 hash(T* p){ return hash(u64(uintptr(p))); }
+
+//// Hash Map
+// Open addressing hash map in the style of SwissTable. Every slot has a
+// control byte that is either empty, deleted or holds 7 bits of the key's
+// hash, lookups compare a whole group of control bytes at once with SIMD and
+// only touch the slots whose byte matched.
+#if defined(__AVX2__)
+#include <immintrin.h>
+constexpr isize hash_map_group_width = 32;
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+constexpr isize hash_map_group_width = 16;
+#else
+constexpr isize hash_map_group_width = 16;
+#endif
+
+constexpr u8 hash_map_ctrl_empty   = 0x80;
+constexpr u8 hash_map_ctrl_deleted = 0xfe;
+
+// Bitmask of the positions in a group whose control byte satisfies a predicate
+static inline
+u32 hash_map_group_match(u8 const* ctrl, u8 h2){
+#if defined(__AVX2__)
+	auto group = _mm256_loadu_si256((__m256i const*)ctrl);
+	return u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8(char(h2)))));
+#elif defined(__SSE2__)
+	auto group = _mm_loadu_si128((__m128i const*)ctrl);
+	return u32(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(char(h2)))));
+#else
+	u32 mask = 0;
+	for(isize i = 0; i < hash_map_group_width; i += 1){
+		mask |= u32(ctrl[i] == h2) << i;
+	}
+	return mask;
+#endif
+}
+
+static inline
+u32 hash_map_group_match_empty(u8 const* ctrl){
+	return hash_map_group_match(ctrl, hash_map_ctrl_empty);
+}
+
+// Empty and deleted are the only control bytes with the sign bit set
+static inline
+u32 hash_map_group_match_free(u8 const* ctrl){
+#if defined(__AVX2__)
+	return u32(_mm256_movemask_epi8(_mm256_loadu_si256((__m256i const*)ctrl)));
+#elif defined(__SSE2__)
+	return u32(_mm_movemask_epi8(_mm_loadu_si128((__m128i const*)ctrl)));
+#else
+	u32 mask = 0;
+	for(isize i = 0; i < hash_map_group_width; i += 1){
+		mask |= u32(ctrl[i] >> 7) << i;
+	}
+	return mask;
+#endif
+}
+
+template<typename K, typename V>
+struct HashMapSlot {
+	K key;
+	V value;
+};
+
+template<typename K, typename V>
+struct HashMap {
+	u8*                 _ctrl;
+	HashMapSlot<K, V>*  _slots;
+	isize               _capacity; // 0 or a power of 2 multiple of the group width
+	isize               _length;
+	isize               _growth_left;
+	Allocator           _allocator;
+};
+
+template<typename K, typename V> constexpr
+auto len(HashMap<K, V> const& m){ return m._length; }
+
+template<typename K, typename V> constexpr
+auto cap(HashMap<K, V> const& m){ return m._capacity; }
+
+template<typename K, typename V> constexpr
+auto allocator(HashMap<K, V> const& m){ return m._allocator; }
+
+namespace impl_hash_map {
+	template<typename K, typename V>
+	isize alloc_size(isize capacity){
+		return mem_align_forward_size(capacity, alignof(HashMapSlot<K, V>)) + capacity * sizeof(HashMapSlot<K, V>);
+	}
+
+	template<typename K, typename V>
+	isize alloc_align(){
+		return max(isize(alignof(HashMapSlot<K, V>)), hash_map_group_width);
+	}
+
+	static inline
+	isize max_load(isize capacity){
+		return capacity - capacity / 8;
+	}
+
+	// Triangular probing over groups visits every group once when the group
+	// count is a power of 2. Returns the index of the slot holding the key, -1 if absent.
+	template<typename K, typename V>
+	isize find_slot(HashMap<K, V> const* m, K const& key, u64 h){
+		if(m->_capacity == 0){ return -1; }
+
+		isize group_mask = m->_capacity / hash_map_group_width - 1;
+		isize g = isize(h >> 7) & group_mask;
+		u8 h2 = u8(h & 0x7f);
+
+		for(isize step = 1; step <= group_mask + 1; step += 1){
+			u8 const* ctrl = &m->_ctrl[g * hash_map_group_width];
+			for(u32 bits = hash_map_group_match(ctrl, h2); bits != 0; bits &= bits - 1){
+				isize idx = g * hash_map_group_width + __builtin_ctz(bits);
+				if(m->_slots[idx].key == key){ return idx; }
+			}
+			if(hash_map_group_match_empty(ctrl) != 0){ return -1; }
+			g = (g + step) & group_mask;
+		}
+		return -1;
+	}
+
+	// First empty or deleted slot along the key's probe sequence
+	template<typename K, typename V>
+	isize find_free_slot(HashMap<K, V> const* m, u64 h){
+		isize group_mask = m->_capacity / hash_map_group_width - 1;
+		isize g = isize(h >> 7) & group_mask;
+
+		for(isize step = 1; ; step += 1){
+			u32 bits = hash_map_group_match_free(&m->_ctrl[g * hash_map_group_width]);
+			if(bits != 0){
+				return g * hash_map_group_width + __builtin_ctz(bits);
+			}
+			g = (g + step) & group_mask;
+		}
+	}
+
+	// Drop the tombstones without allocating. Live slots are first marked as
+	// deleted (pending) and tombstones as empty, then every pending element
+	// is moved to the first free slot along its probe sequence. Landing on a
+	// pending slot swaps the two and the displaced element is placed next.
+	template<typename K, typename V>
+	void rehash_in_place(HashMap<K, V>* m){
+		for(isize i = 0; i < m->_capacity; i += 1){
+			m->_ctrl[i] = (m->_ctrl[i] & 0x80) ? hash_map_ctrl_empty : hash_map_ctrl_deleted;
+		}
+
+		for(isize i = 0; i < m->_capacity; i += 1){
+			if(m->_ctrl[i] != hash_map_ctrl_deleted){ continue; }
+			u64 h = hash(m->_slots[i].key);
+			isize target = find_free_slot(m, h);
+
+			// Every group probed before this one is full, so it can stay
+			if(target / hash_map_group_width == i / hash_map_group_width){
+				m->_ctrl[i] = u8(h & 0x7f);
+				continue;
+			}
+
+			bool displaced = m->_ctrl[target] == hash_map_ctrl_deleted;
+			m->_ctrl[target] = u8(h & 0x7f);
+			if(displaced){
+				swap(&m->_slots[target], &m->_slots[i]);
+				i -= 1;
+			}
+			else {
+				m->_slots[target] = m->_slots[i];
+				m->_ctrl[i] = hash_map_ctrl_empty;
+			}
+		}
+		m->_growth_left = max_load(m->_capacity) - m->_length;
+	}
+
+	// Move every element into a table of `new_cap` slots, deleted slots are
+	// dropped in the process. Keeping the capacity rehashes in place.
+	template<typename K, typename V>
+	AllocatorError rehash(HashMap<K, V>* m, isize new_cap){
+		if(new_cap == m->_capacity){
+			rehash_in_place(m);
+			return {};
+		}
+
+		auto [mem, err] = mem_alloc(m->_allocator, alloc_size<K, V>(new_cap), alloc_align<K, V>());
+		if(!mem){ return err; }
+
+		HashMap<K, V> fresh = *m;
+		fresh._ctrl = (u8*)mem;
+		fresh._slots = (HashMapSlot<K, V>*)((byte*)mem + mem_align_forward_size(new_cap, alignof(HashMapSlot<K, V>)));
+		fresh._capacity = new_cap;
+		mem_set(fresh._ctrl, hash_map_ctrl_empty, new_cap);
+
+		for(isize i = 0; i < m->_capacity; i += 1){
+			if(m->_ctrl[i] & 0x80){ continue; }
+			auto& slot = m->_slots[i];
+			u64 h = hash(slot.key);
+			isize idx = find_free_slot(&fresh, h);
+			fresh._ctrl[idx] = u8(h & 0x7f);
+			fresh._slots[idx] = slot;
+		}
+		fresh._growth_left = max_load(new_cap) - m->_length;
+
+		if(m->_capacity > 0){
+			mem_free(m->_allocator, m->_ctrl, alloc_size<K, V>(m->_capacity), alloc_align<K, V>());
+		}
+		*m = fresh;
+		return {};
+	}
+}
+
+template<typename K, typename V>
+HashMap<K, V> make_hash_map(Allocator allocator){
+	HashMap<K, V> m;
+	m._ctrl        = nullptr;
+	m._slots       = nullptr;
+	m._capacity    = 0;
+	m._length      = 0;
+	m._growth_left = 0;
+	m._allocator   = allocator;
+	return m;
+}
+
+template<typename K, typename V>
+void destroy(HashMap<K, V>* m){
+	if(m->_capacity > 0){
+		mem_free(m->_allocator, m->_ctrl, impl_hash_map::alloc_size<K, V>(m->_capacity), impl_hash_map::alloc_align<K, V>());
+	}
+	*m = make_hash_map<K, V>(m->_allocator);
+}
+
+template<typename K, typename V>
+void clear(HashMap<K, V>* m){
+	mem_set(m->_ctrl, hash_map_ctrl_empty, m->_capacity);
+	m->_length = 0;
+	m->_growth_left = impl_hash_map::max_load(m->_capacity);
+}
+
+// Make room for at least `count` elements without further rehashing
+template<typename K, typename V>
+AllocatorError reserve(HashMap<K, V>* m, isize count){
+	isize new_cap = hash_map_group_width;
+	while(impl_hash_map::max_load(new_cap) < count){
+		new_cap *= 2;
+	}
+	if(new_cap <= m->_capacity){ return {}; }
+	return impl_hash_map::rehash(m, new_cap);
+}
+
+template<typename K, typename V>
+V* find(HashMap<K, V>* m, K key){
+	isize idx = impl_hash_map::find_slot(m, key, hash(key));
+	return idx < 0 ? nullptr : &m->_slots[idx].value;
+}
+
+template<typename K, typename V>
+V const* find(HashMap<K, V> const* m, K key){
+	isize idx = impl_hash_map::find_slot(m, key, hash(key));
+	return idx < 0 ? nullptr : &m->_slots[idx].value;
+}
+
+// Insert or overwrite the value associated with key
+template<typename K, typename V>
+AllocatorError insert(HashMap<K, V>* m, K key, V value){
+	u64 h = hash(key);
+	isize idx = impl_hash_map::find_slot(m, key, h);
+	if(idx >= 0){
+		m->_slots[idx].value = value;
+		return {};
+	}
+
+	idx = m->_capacity > 0 ? impl_hash_map::find_free_slot(m, h) : -1;
+	if(idx < 0 || (m->_growth_left == 0 && m->_ctrl[idx] == hash_map_ctrl_empty)){
+		// Only grow when live elements fill the table, a table full of tombstones
+		// gets rehashed in place at the same capacity instead.
+		isize new_cap = max(m->_capacity, hash_map_group_width);
+		if(m->_length + 1 > impl_hash_map::max_load(new_cap) / 2){
+			new_cap *= 2;
+		}
+		auto err = impl_hash_map::rehash(m, new_cap);
+		if(!ok(err)){ return err; }
+		idx = impl_hash_map::find_free_slot(m, h);
+	}
+
+	if(m->_ctrl[idx] == hash_map_ctrl_empty){
+		m->_growth_left -= 1;
+	}
+	m->_ctrl[idx] = u8(h & 0x7f);
+	m->_slots[idx] = { key, value };
+	m->_length += 1;
+	return {};
+}
+
+template<typename K, typename V>
+bool remove(HashMap<K, V>* m, K key){
+	isize idx = impl_hash_map::find_slot(m, key, hash(key));
+	if(idx < 0){ return false; }
+
+	// A group that still has an empty slot never made a probe move past it,
+	// so the slot can go back to empty instead of leaving a tombstone.
+	isize group = idx - (idx % hash_map_group_width);
+	if(hash_map_group_match_empty(&m->_ctrl[group]) != 0){
+		m->_ctrl[idx] = hash_map_ctrl_empty;
+		m->_growth_left += 1;
+	}
+	else {
+		m->_ctrl[idx] = hash_map_ctrl_deleted;
+	}
+	m->_length -= 1;
+	return true;
+}
+
+// Calls f(key, value) for every element, in no particular order
+template<typename K, typename V, typename F>
+void for_each(HashMap<K, V>* m, F&& f){
+	for(isize i = 0; i < m->_capacity; i += 1){
+		if(m->_ctrl[i] & 0x80){ continue; }
+		f(m->_slots[i].key, m->_slots[i].value);
+	}
+}
+
+//// Concurrent Hash Map
+// Hash map for read heavy data shared between threads. Keys are spread over
+// independently locked shards, writers take the lock of their key's shard
+// while readers never lock: they validate what they read against the shard's
+// sequence counter and retry if a writer raced them.
+//
+// Published keys are never overwritten in place (removal leaves a tombstone,
+// growing builds a new table). Lookups run inside of an epoch (see
+// epoch_enter) and replaced tables are retired, a writer frees them on a
+// later grow once every reader that could have loaded them has left. The
+// retired list is bounded by the grows that happen during a single lookup.
+// Keys and values are copied out without locking and must be trivially
+// copyable, the allocator must be thread safe.
+constexpr isize concurrent_hash_map_shard_count = 64;
+
+template<typename K, typename V>
+struct ConcurrentHashMapTable {
+	HashMap<K, V> map;
+	ConcurrentHashMapTable* retired_next;
+	u64 retired_epoch;
+};
+
+template<typename K, typename V>
+struct alignas(cache_line_size) ConcurrentHashMapShard {
+	Atomic<u32> seq; // Odd while a writer is modifying the shard
+	SpinLock lock;
+	Atomic<ConcurrentHashMapTable<K, V>*> table;
+	ConcurrentHashMapTable<K, V>* retired; // Newest first
+};
+
+template<typename K, typename V>
+struct ConcurrentHashMap {
+	ConcurrentHashMapShard<K, V>* _shards;
+	Allocator _allocator;
+};
+
+namespace impl_concurrent_hash_map {
+	template<typename K, typename V>
+	ConcurrentHashMapShard<K, V>* shard_of(ConcurrentHashMap<K, V>* m, u64 h){
+		constexpr isize shard_bits = __builtin_ctzll(concurrent_hash_map_shard_count);
+		return &m->_shards[h >> (64 - shard_bits)];
+	}
+
+	template<typename K, typename V>
+	isize find_slot(HashMap<K, V> const* t, K const& key, u64 h){
+		if(t->_capacity == 0){ return -1; }
+
+		isize group_mask = t->_capacity / hash_map_group_width - 1;
+		isize g = isize(h >> 7) & group_mask;
+		u8 h2 = u8(h & 0x7f);
+
+		for(isize step = 1; step <= group_mask + 1; step += 1){
+			u8 const* ctrl = &t->_ctrl[g * hash_map_group_width];
+			for(u32 bits = hash_map_group_match(ctrl, h2); bits != 0; bits &= bits - 1){
+				isize idx = g * hash_map_group_width + __builtin_ctz(bits);
+				// Pairs with the release store publishing the slot
+				if(__atomic_load_n(&t->_ctrl[idx], __ATOMIC_ACQUIRE) != h2){ continue; }
+				if(t->_slots[idx].key == key){ return idx; }
+			}
+			if(hash_map_group_match_empty(ctrl) != 0){ return -1; }
+			g = (g + step) & group_mask;
+		}
+		return -1;
+	}
+
+	template<typename K, typename V>
+	isize find_empty_slot(HashMap<K, V> const* t, u64 h){
+		isize group_mask = t->_capacity / hash_map_group_width - 1;
+		isize g = isize(h >> 7) & group_mask;
+
+		for(isize step = 1; step <= group_mask + 1; step += 1){
+			u32 bits = hash_map_group_match_empty(&t->_ctrl[g * hash_map_group_width]);
+			if(bits != 0){
+				return g * hash_map_group_width + __builtin_ctz(bits);
+			}
+			g = (g + step) & group_mask;
+		}
+		return -1;
+	}
+
+	template<typename K, typename V>
+	void free_table(ConcurrentHashMapTable<K, V>* t, Allocator allocator){
+		destroy(&t->map);
+		destroy(t, allocator);
+	}
+
+	// Free the retired tables no reader can still be looking at
+	template<typename K, typename V>
+	void reclaim(ConcurrentHashMapShard<K, V>* shard, Allocator allocator){
+		if(!shard->retired){ return; }
+		u64 oldest = epoch_oldest_active();
+		auto link = &shard->retired;
+		while(*link && (*link)->retired_epoch >= oldest){
+			link = &(*link)->retired_next;
+		}
+		// Older tables were retired at earlier epochs, they go too
+		for(auto t = *link; t != nullptr;){
+			auto next = t->retired_next;
+			free_table(t, allocator);
+			t = next;
+		}
+		*link = nullptr;
+	}
+
+	// Copy the live entries of the shard into a new table and publish it. This
+	// also drops tombstones, churn at a stable size rebuilds at the same
+	// capacity. The previous table is retired.
+	template<typename K, typename V>
+	AllocatorError grow(ConcurrentHashMapShard<K, V>* shard, Allocator allocator){
+		auto old = shard->table.load(std::memory_order_relaxed);
+		isize length = old ? old->map._length : 0;
+
+		isize new_cap = max(old ? old->map._capacity : 0, hash_map_group_width);
+		if(length + 1 > impl_hash_map::max_load(new_cap) / 2){
+			new_cap *= 2;
+		}
+
+		auto table = make<ConcurrentHashMapTable<K, V>>(allocator);
+		if(!table){ return AllocatorError::OutOfMemory; }
+		table->map = make_hash_map<K, V>(allocator);
+		table->retired_next = nullptr;
+		table->retired_epoch = 0;
+
+		auto err = impl_hash_map::rehash(&table->map, new_cap);
+		if(!ok(err)){
+			destroy(table, allocator);
+			return err;
+		}
+
+		if(old){
+			auto& src = old->map;
+			for(isize i = 0; i < src._capacity; i += 1){
+				if(src._ctrl[i] & 0x80){ continue; }
+				u64 h = hash(src._slots[i].key);
+				isize idx = find_empty_slot(&table->map, h);
+				table->map._ctrl[idx] = u8(h & 0x7f);
+				table->map._slots[idx] = src._slots[i];
+			}
+			table->map._length = length;
+			table->map._growth_left -= length;
+		}
+
+		shard->table.store(table, std::memory_order_release);
+		if(old){
+			old->retired_epoch = epoch_advance();
+			old->retired_next = shard->retired;
+			shard->retired = old;
+		}
+		reclaim(shard, allocator);
+		return {};
+	}
+
+	template<typename K, typename V>
+	void write_begin(ConcurrentHashMapShard<K, V>* shard){
+		spin_lock(&shard->lock);
+		shard->seq.store(shard->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	template<typename K, typename V>
+	void write_end(ConcurrentHashMapShard<K, V>* shard){
+		shard->seq.store(shard->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		spin_unlock(&shard->lock);
+	}
+
+}
+
+template<typename K, typename V>
+ConcurrentHashMap<K, V> make_concurrent_hash_map(Allocator allocator){
+	ConcurrentHashMap<K, V> m;
+	m._allocator = allocator;
+	m._shards = raw_data(make<ConcurrentHashMapShard<K, V>>(concurrent_hash_map_shard_count, allocator));
+	return m;
+}
+
+template<typename K, typename V>
+void destroy(ConcurrentHashMap<K, V>* m){
+	if(!m->_shards){ return; }
+	for(isize i = 0; i < concurrent_hash_map_shard_count; i += 1){
+		auto& shard = m->_shards[i];
+		if(auto t = shard.table.load(std::memory_order_acquire)){
+			impl_concurrent_hash_map::free_table(t, m->_allocator);
+		}
+		for(auto t = shard.retired; t != nullptr;){
+			auto next = t->retired_next;
+			impl_concurrent_hash_map::free_table(t, m->_allocator);
+			t = next;
+		}
+	}
+	destroy(Slice<ConcurrentHashMapShard<K, V>>(m->_shards, concurrent_hash_map_shard_count), m->_allocator);
+	m->_shards = nullptr;
+}
+
+// Lock free lookup, copies the value into `out` when the key is present.
+template<typename K, typename V>
+bool find(ConcurrentHashMap<K, V>* m, K key, V* out){
+	u64 h = hash(key);
+	auto shard = impl_concurrent_hash_map::shard_of(m, h);
+
+	epoch_enter();
+	defer(epoch_exit());
+	for(;;){
+		u32 seq = shard->seq.load(std::memory_order_acquire);
+		if(seq & 1){
+			cpu_relax();
+			continue;
+		}
+
+		bool found = false;
+		V value{};
+		if(auto t = shard->table.load(std::memory_order_acquire)){
+			isize idx = impl_concurrent_hash_map::find_slot(&t->map, key, h);
+			if(idx >= 0){
+				found = true;
+				value = t->map._slots[idx].value;
+			}
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(shard->seq.load(std::memory_order_relaxed) == seq){
+			if(found && out){ *out = value; }
+			return found;
+		}
+	}
+}
+
+// Insert or overwrite the value associated with key
+template<typename K, typename V>
+AllocatorError insert(ConcurrentHashMap<K, V>* m, K key, V value){
+	u64 h = hash(key);
+	auto shard = impl_concurrent_hash_map::shard_of(m, h);
+
+	impl_concurrent_hash_map::write_begin(shard);
+	defer(impl_concurrent_hash_map::write_end(shard));
+
+	auto t = shard->table.load(std::memory_order_relaxed);
+	if(t){
+		isize idx = impl_concurrent_hash_map::find_slot(&t->map, key, h);
+		if(idx >= 0){
+			t->map._slots[idx].value = value;
+			return {};
+		}
+	}
+
+	if(!t || t->map._growth_left == 0){
+		auto err = impl_concurrent_hash_map::grow(shard, m->_allocator);
+		if(!ok(err)){ return err; }
+		t = shard->table.load(std::memory_order_relaxed);
+	}
+
+	isize idx = impl_concurrent_hash_map::find_empty_slot(&t->map, h);
+	t->map._slots[idx] = { key, value };
+	__atomic_store_n(&t->map._ctrl[idx], u8(h & 0x7f), __ATOMIC_RELEASE);
+	__atomic_store_n(&t->map._length, t->map._length + 1, __ATOMIC_RELAXED);
+	t->map._growth_left -= 1;
+	return {};
+}
+
+template<typename K, typename V>
+bool remove(ConcurrentHashMap<K, V>* m, K key){
+	u64 h = hash(key);
+	auto shard = impl_concurrent_hash_map::shard_of(m, h);
+
+	impl_concurrent_hash_map::write_begin(shard);
+	defer(impl_concurrent_hash_map::write_end(shard));
+
+	auto t = shard->table.load(std::memory_order_relaxed);
+	if(!t){ return false; }
+
+	isize idx = impl_concurrent_hash_map::find_slot(&t->map, key, h);
+	if(idx < 0){ return false; }
+
+	// Always a tombstone, the key must stay intact for concurrent readers
+	__atomic_store_n(&t->map._ctrl[idx], hash_map_ctrl_deleted, __ATOMIC_RELEASE);
+	__atomic_store_n(&t->map._length, t->map._length - 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+// Approximate while writers are active
+template<typename K, typename V>
+isize len(ConcurrentHashMap<K, V> const& m){
+	isize n = 0;
+	epoch_enter();
+	defer(epoch_exit());
+	for(isize i = 0; i < concurrent_hash_map_shard_count; i += 1){
+		if(auto t = m._shards[i].table.load(std::memory_order_acquire)){
+			n += __atomic_load_n(&t->map._length, __ATOMIC_RELAXED);
+		}
+	}
+	return n;
+}
+
+//// Clock Cache
+// Fixed capacity cache with CLOCK eviction (second chance). Entries live in a
+// flat array indexed by a HashMap, a hit only sets the entry's reference byte
+// and eviction sweeps a hand over those bytes, clearing them until it finds
+// an unreferenced entry. No list is relinked on hits. New entries start
+// unreferenced, so keys that are never read again are evicted first.
+struct ClockCacheStats {
+	i64 hits;
+	i64 misses;
+	i64 insertions;
+	i64 evictions;
+};
+
+template<typename K, typename V>
+struct ClockCacheEntry {
+	K key;
+	V value;
+};
+
+template<typename K, typename V>
+struct ClockCache {
+	HashMap<K, i32>        _index;
+	ClockCacheEntry<K, V>* _entries;
+	u8*                    _referenced;
+	isize                  _capacity;
+	isize                  _length;
+	isize                  _hand;
+	ClockCacheStats        _stats;
+	Allocator              _allocator;
+};
+
+// The cache has capacity 0 (and every insert fails) if allocation failed
+template<typename K, typename V>
+ClockCache<K, V> make_clock_cache(Allocator allocator, isize capacity){
+	ensure(capacity > 0 && capacity <= isize(0x7fffffff), "Invalid cache capacity");
+	ClockCache<K, V> c;
+	c._index = make_hash_map<K, i32>(allocator);
+	c._entries = raw_data(make<ClockCacheEntry<K, V>>(capacity, allocator));
+	c._referenced = raw_data(make<u8>(capacity, allocator));
+	c._capacity = capacity;
+	c._length = 0;
+	c._hand = 0;
+	c._stats = {};
+	c._allocator = allocator;
+
+	// Twice the room so the index never has to grow: tombstones left behind by
+	// evictions are dropped by rehashing in place instead.
+	if(!c._entries || !c._referenced || !ok(reserve(&c._index, 2 * capacity))){
+		destroy(&c);
+	}
+	return c;
+}
+
+template<typename K, typename V>
+void destroy(ClockCache<K, V>* c){
+	destroy(&c->_index);
+	if(c->_entries){
+		destroy(Slice<ClockCacheEntry<K, V>>(c->_entries, c->_capacity), c->_allocator);
+	}
+	if(c->_referenced){
+		destroy(Slice<u8>(c->_referenced, c->_capacity), c->_allocator);
+	}
+	c->_entries = nullptr;
+	c->_referenced = nullptr;
+	c->_capacity = 0;
+	c->_length = 0;
+	c->_hand = 0;
+}
+
+template<typename K, typename V>
+void clear(ClockCache<K, V>* c){
+	clear(&c->_index);
+	c->_length = 0;
+	c->_hand = 0;
+}
+
+template<typename K, typename V> constexpr
+auto len(ClockCache<K, V> const& c){ return c._length; }
+
+template<typename K, typename V> constexpr
+auto cap(ClockCache<K, V> const& c){ return c._capacity; }
+
+template<typename K, typename V> constexpr
+ClockCacheStats stats(ClockCache<K, V> const& c){ return c._stats; }
+
+template<typename K, typename V>
+void reset_stats(ClockCache<K, V>* c){
+	c->_stats = {};
+}
+
+// Looks the key up and counts a hit or a miss. The pointer stays valid until
+// the next insert or remove.
+template<typename K, typename V>
+V* find(ClockCache<K, V>* c, K key){
+	i32* slot = find(&c->_index, key);
+	if(!slot){
+		c->_stats.misses += 1;
+		return nullptr;
+	}
+	c->_stats.hits += 1;
+	c->_referenced[*slot] = 1;
+	return &c->_entries[*slot].value;
+}
+
+// Insert or overwrite, evicting an entry when the cache is full. The evicted
+// entry is copied to `evicted` when given, so its value can be released.
+template<typename K, typename V>
+AllocatorError insert(ClockCache<K, V>* c, K key, V value, ClockCacheEntry<K, V>* evicted = nullptr, bool* did_evict = nullptr){
+	if(did_evict){ *did_evict = false; }
+	if(c->_capacity == 0){ return AllocatorError::OutOfMemory; }
+
+	i32* existing = find(&c->_index, key);
+	if(existing){
+		c->_entries[*existing].value = value;
+		c->_referenced[*existing] = 1;
+		return {};
+	}
+
+	isize slot;
+	if(c->_length < c->_capacity){
+		slot = c->_length;
+		auto err = insert(&c->_index, key, i32(slot));
+		if(!ok(err)){ return err; }
+		c->_length += 1;
+	}
+	else {
+		while(c->_referenced[c->_hand]){
+			c->_referenced[c->_hand] = 0;
+			c->_hand = c->_hand + 1 == c->_capacity ? 0 : c->_hand + 1;
+		}
+		slot = c->_hand;
+		c->_hand = c->_hand + 1 == c->_capacity ? 0 : c->_hand + 1;
+
+		// The index has room for the key, replacing one can't fail
+		ClockCacheEntry<K, V> victim = c->_entries[slot];
+		remove(&c->_index, victim.key);
+		auto err = insert(&c->_index, key, i32(slot));
+		if(!ok(err)){
+			insert(&c->_index, victim.key, i32(slot));
+			return err;
+		}
+		c->_stats.evictions += 1;
+		if(evicted){ *evicted = victim; }
+		if(did_evict){ *did_evict = true; }
+	}
+
+	c->_entries[slot] = { key, value };
+	c->_referenced[slot] = 0;
+	c->_stats.insertions += 1;
+	return {};
+}
+
+// The last entry moves into the freed slot to keep the array dense
+template<typename K, typename V>
+bool remove(ClockCache<K, V>* c, K key){
+	i32* found = find(&c->_index, key);
+	if(!found){ return false; }
+	isize slot = *found;
+	remove(&c->_index, key);
+
+	isize last = c->_length - 1;
+	if(slot != last){
+		c->_entries[slot] = c->_entries[last];
+		c->_referenced[slot] = c->_referenced[last];
+		*find(&c->_index, c->_entries[slot].key) = i32(slot);
+	}
+	c->_length -= 1;
+	if(c->_hand >= c->_length){ c->_hand = 0; }
+	return true;
+}
+
+//// Adaptive Radix Tree
+// Radix tree over the bytes of String keys, inner nodes come in 4 sizes
+// (4, 16, 48 and 256 children) and are grown or shrunk to fit their fan out.
+// Chains of single child nodes are collapsed into a prefix stored in the node
+// (the first `art_max_prefix` bytes of it, longer prefixes are checked against
+// a leaf instead). Leaves own a copy of their key and may sit above their full
+// depth when nothing else shares their path. A key that ends inside the tree
+// (a prefix of other keys) lives in the `terminal` slot of the node where it
+// ends. Traversal visits keys in bytewise lexicographic order.
+constexpr isize art_max_prefix = 10;
+
+enum class ArtNodeType : u8 {
+	Node4, Node16, Node48, Node256,
+};
+
+// Child references are tagged pointers, the low bit is set for leaves
+using ArtRef = uintptr;
+
+struct ArtNode {
+	ArtNodeType type;
+	u16 count; // Children, not counting the terminal
+	u32 prefix_length;
+	byte prefix[art_max_prefix];
+	ArtRef terminal; // Leaf for the key that ends right after the prefix, or 0
+};
+
+struct ArtNode4 : ArtNode {
+	byte keys[4]; // Sorted
+	ArtRef children[4];
+};
+
+struct ArtNode16 : ArtNode {
+	byte keys[16]; // Sorted
+	ArtRef children[16];
+};
+
+struct ArtNode48 : ArtNode {
+	u8 index[256]; // Key byte -> child slot + 1, 0 when absent
+	ArtRef children[48];
+};
+
+struct ArtNode256 : ArtNode {
+	ArtRef children[256];
+};
+
+// Key bytes are stored right after the leaf
+template<typename V>
+struct ArtLeaf {
+	V value;
+	isize key_length;
+};
+
+template<typename V>
+struct ArtTree {
+	ArtRef    _root;
+	isize     _length;
+	Allocator _allocator;
+};
+
+template<typename V> constexpr
+auto len(ArtTree<V> const& t){ return t._length; }
+
+template<typename V>
+ArtTree<V> make_art_tree(Allocator allocator){
+	ArtTree<V> t;
+	t._root = 0;
+	t._length = 0;
+	t._allocator = allocator;
+	return t;
+}
+
+namespace impl_art {
+	static inline bool is_leaf(ArtRef r){ return r & 1; }
+
+	static inline ArtNode* node_of(ArtRef r){ return (ArtNode*)r; }
+
+	template<typename V>
+	ArtLeaf<V>* leaf_of(ArtRef r){ return (ArtLeaf<V>*)(r & ~ArtRef(1)); }
+
+	template<typename V>
+	String leaf_key(ArtLeaf<V> const* l){
+		return String((byte const*)(l + 1), l->key_length);
+	}
+
+	template<typename V>
+	ArtRef new_leaf(ArtTree<V>* t, String key, V const& value){
+		isize size = isize(sizeof(ArtLeaf<V>)) + len(key);
+		auto [p, err] = mem_alloc(t->_allocator, size, alignof(ArtLeaf<V>));
+		if(!p){ return 0; }
+		auto l = (ArtLeaf<V>*)p;
+		l->value = value;
+		l->key_length = len(key);
+		mem_copy_no_overlap(l + 1, raw_data(key), len(key));
+		return ArtRef(l) | 1;
+	}
+
+	template<typename V>
+	void free_leaf(ArtTree<V>* t, ArtRef r){
+		auto l = leaf_of<V>(r);
+		mem_free(t->_allocator, l, isize(sizeof(ArtLeaf<V>)) + l->key_length, alignof(ArtLeaf<V>));
+	}
+
+	static inline
+	isize node_size(ArtNodeType type){
+		switch(type){
+			case ArtNodeType::Node4:   return sizeof(ArtNode4);
+			case ArtNodeType::Node16:  return sizeof(ArtNode16);
+			case ArtNodeType::Node48:  return sizeof(ArtNode48);
+			case ArtNodeType::Node256: return sizeof(ArtNode256);
+		}
+		return 0;
+	}
+
+	template<typename V>
+	ArtNode* new_node(ArtTree<V>* t, ArtNodeType type){
+		isize size = node_size(type);
+		auto [p, err] = mem_alloc(t->_allocator, size, alignof(ArtNode256));
+		if(!p){ return nullptr; }
+		mem_set(p, 0, size);
+		auto n = (ArtNode*)p;
+		n->type = type;
+		return n;
+	}
+
+	template<typename V>
+	void free_node(ArtTree<V>* t, ArtNode* n){
+		mem_free(t->_allocator, n, node_size(n->type), alignof(ArtNode256));
+	}
+
+	// Header fields (prefix and terminal) carry over when a node changes size
+	static inline
+	void copy_header(ArtNode* dst, ArtNode const* src){
+		dst->count = src->count;
+		dst->prefix_length = src->prefix_length;
+		mem_copy_no_overlap(dst->prefix, src->prefix, art_max_prefix);
+		dst->terminal = src->terminal;
+	}
+
+	static inline
+	ArtRef* find_child(ArtNode* n, byte b){
+		switch(n->type){
+			case ArtNodeType::Node4: {
+				auto n4 = (ArtNode4*)n;
+				for(isize i = 0; i < n->count; i += 1){
+					if(n4->keys[i] == b){ return &n4->children[i]; }
+				}
+			} break;
+			case ArtNodeType::Node16: {
+				auto n16 = (ArtNode16*)n;
+#if defined(__SSE2__)
+				__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(char(b)), _mm_loadu_si128((__m128i const*)n16->keys));
+				u32 mask = u32(_mm_movemask_epi8(cmp)) & ((u32(1) << n->count) - 1);
+				if(mask){ return &n16->children[__builtin_ctz(mask)]; }
+#else
+				for(isize i = 0; i < n->count; i += 1){
+					if(n16->keys[i] == b){ return &n16->children[i]; }
+				}
+#endif
+			} break;
+			case ArtNodeType::Node48: {
+				auto n48 = (ArtNode48*)n;
+				if(n48->index[b]){ return &n48->children[n48->index[b] - 1]; }
+			} break;
+			case ArtNodeType::Node256: {
+				auto n256 = (ArtNode256*)n;
+				if(n256->children[b]){ return &n256->children[b]; }
+			} break;
+		}
+		return nullptr;
+	}
+
+	// Insert into a sorted key/child array with room for one more
+	static inline
+	void sorted_insert(byte* keys, ArtRef* children, isize count, byte b, ArtRef child){
+		isize pos = 0;
+		while(pos < count && keys[pos] < b){ pos += 1; }
+		for(isize i = count; i > pos; i -= 1){
+			keys[i] = keys[i - 1];
+			children[i] = children[i - 1];
+		}
+		keys[pos] = b;
+		children[pos] = child;
+	}
+
+	// Add a child, growing the node (and updating *ref) when it is full
+	template<typename V>
+	AllocatorError add_child(ArtTree<V>* t, ArtRef* ref, byte b, ArtRef child){
+		ArtNode* n = node_of(*ref);
+		switch(n->type){
+			case ArtNodeType::Node4: {
+				auto n4 = (ArtNode4*)n;
+				if(n->count < 4){
+					sorted_insert(n4->keys, n4->children, n->count, b, child);
+					n->count += 1;
+					return {};
+				}
+				auto n16 = (ArtNode16*)new_node(t, ArtNodeType::Node16);
+				if(!n16){ return AllocatorError::OutOfMemory; }
+				copy_header(n16, n);
+				mem_copy_no_overlap(n16->keys, n4->keys, sizeof(n4->keys));
+				mem_copy_no_overlap(n16->children, n4->children, sizeof(n4->children));
+				sorted_insert(n16->keys, n16->children, n16->count, b, child);
+				n16->count += 1;
+				free_node(t, n);
+				*ref = ArtRef(n16);
+			} break;
+			case ArtNodeType::Node16: {
+				auto n16 = (ArtNode16*)n;
+				if(n->count < 16){
+					sorted_insert(n16->keys, n16->children, n->count, b, child);
+					n->count += 1;
+					return {};
+				}
+				auto n48 = (ArtNode48*)new_node(t, ArtNodeType::Node48);
+				if(!n48){ return AllocatorError::OutOfMemory; }
+				copy_header(n48, n);
+				for(isize i = 0; i < 16; i += 1){
+					n48->children[i] = n16->children[i];
+					n48->index[n16->keys[i]] = u8(i + 1);
+				}
+				n48->children[16] = child;
+				n48->index[b] = 17;
+				n48->count += 1;
+				free_node(t, n);
+				*ref = ArtRef(n48);
+			} break;
+			case ArtNodeType::Node48: {
+				auto n48 = (ArtNode48*)n;
+				if(n->count < 48){
+					isize slot = 0;
+					while(n48->children[slot]){ slot += 1; }
+					n48->children[slot] = child;
+					n48->index[b] = u8(slot + 1);
+					n->count += 1;
+					return {};
+				}
+				auto n256 = (ArtNode256*)new_node(t, ArtNodeType::Node256);
+				if(!n256){ return AllocatorError::OutOfMemory; }
+				copy_header(n256, n);
+				for(isize i = 0; i < 256; i += 1){
+					if(n48->index[i]){ n256->children[i] = n48->children[n48->index[i] - 1]; }
+				}
+				n256->children[b] = child;
+				n256->count += 1;
+				free_node(t, n);
+				*ref = ArtRef(n256);
+			} break;
+			case ArtNodeType::Node256: {
+				auto n256 = (ArtNode256*)n;
+				n256->children[b] = child;
+				n->count += 1;
+			} break;
+		}
+		return {};
+	}
+
+	static inline
+	void remove_child(ArtNode* n, byte b){
+		switch(n->type){
+			case ArtNodeType::Node4:
+			case ArtNodeType::Node16: {
+				byte* keys = n->type == ArtNodeType::Node4 ? ((ArtNode4*)n)->keys : ((ArtNode16*)n)->keys;
+				ArtRef* children = n->type == ArtNodeType::Node4 ? ((ArtNode4*)n)->children : ((ArtNode16*)n)->children;
+				isize pos = 0;
+				while(keys[pos] != b){ pos += 1; }
+				for(isize i = pos; i < n->count - 1; i += 1){
+					keys[i] = keys[i + 1];
+					children[i] = children[i + 1];
+				}
+				n->count -= 1;
+			} break;
+			case ArtNodeType::Node48: {
+				auto n48 = (ArtNode48*)n;
+				n48->children[n48->index[b] - 1] = 0;
+				n48->index[b] = 0;
+				n->count -= 1;
+			} break;
+			case ArtNodeType::Node256: {
+				((ArtNode256*)n)->children[b] = 0;
+				n->count -= 1;
+			} break;
+		}
+	}
+
+	// Leftmost leaf below a node, all leaves below it share the node's full prefix
+	template<typename V>
+	ArtLeaf<V>* minimum(ArtRef r){
+		while(!is_leaf(r)){
+			ArtNode* n = node_of(r);
+			if(n->terminal){ return leaf_of<V>(n->terminal); }
+			switch(n->type){
+				case ArtNodeType::Node4:  r = ((ArtNode4*)n)->children[0]; break;
+				case ArtNodeType::Node16: r = ((ArtNode16*)n)->children[0]; break;
+				case ArtNodeType::Node48: {
+					auto n48 = (ArtNode48*)n;
+					isize i = 0;
+					while(!n48->index[i]){ i += 1; }
+					r = n48->children[n48->index[i] - 1];
+				} break;
+				case ArtNodeType::Node256: {
+					auto n256 = (ArtNode256*)n;
+					isize i = 0;
+					while(!n256->children[i]){ i += 1; }
+					r = n256->children[i];
+				} break;
+			}
+		}
+		return leaf_of<V>(r);
+	}
+
+	// Number of stored prefix bytes matching key[depth:]
+	static inline
+	isize check_prefix(ArtNode const* n, String key, isize depth){
+		isize limit = min(min(isize(n->prefix_length), art_max_prefix), len(key) - depth);
+		isize i = 0;
+		while(i < limit && n->prefix[i] == key[depth + i]){ i += 1; }
+		return i;
+	}
+
+	// Length of the part of the node's full prefix matching key[depth:]
+	template<typename V>
+	isize prefix_mismatch(ArtNode const* n, String key, isize depth){
+		isize limit = min(isize(n->prefix_length), len(key) - depth);
+		isize i = check_prefix(n, key, depth);
+		if(i < min(isize(n->prefix_length), art_max_prefix) || isize(n->prefix_length) <= art_max_prefix){
+			return i;
+		}
+		// Past the stored bytes, compare against the full key of any leaf below
+		String other = leaf_key(minimum<V>(ArtRef(n)));
+		while(i < limit && other[depth + i] == key[depth + i]){ i += 1; }
+		return i;
+	}
+
+	template<typename V>
+	AllocatorError insert_rec(ArtTree<V>* t, ArtRef* ref, String key, isize depth, V const& value, bool* inserted){
+		if(*ref == 0){
+			ArtRef l = new_leaf(t, key, value);
+			if(!l){ return AllocatorError::OutOfMemory; }
+			*ref = l;
+			*inserted = true;
+			return {};
+		}
+
+		if(is_leaf(*ref)){
+			auto existing = leaf_of<V>(*ref);
+			String other = leaf_key(existing);
+			if(other == key){
+				existing->value = value;
+				return {};
+			}
+
+			// Split into a node holding both leaves below their common prefix
+			isize limit = min(len(other), len(key));
+			isize common = depth;
+			while(common < limit && other[common] == key[common]){ common += 1; }
+
+			ArtRef l = new_leaf(t, key, value);
+			if(!l){ return AllocatorError::OutOfMemory; }
+			ArtNode* n = new_node(t, ArtNodeType::Node4);
+			if(!n){
+				free_leaf(t, l);
+				return AllocatorError::OutOfMemory;
+			}
+			n->prefix_length = u32(common - depth);
+			mem_copy_no_overlap(n->prefix, raw_data(key) + depth, min(common - depth, art_max_prefix));
+
+			ArtRef node_ref = ArtRef(n);
+			if(len(other) == common){ n->terminal = *ref; }
+			else { add_child(t, &node_ref, other[common], *ref); }
+			if(len(key) == common){ n->terminal = l; }
+			else { add_child(t, &node_ref, key[common], l); }
+
+			*ref = node_ref;
+			*inserted = true;
+			return {};
+		}
+
+		ArtNode* n = node_of(*ref);
+		if(n->prefix_length){
+			isize mismatch = prefix_mismatch<V>(n, key, depth);
+			if(mismatch < isize(n->prefix_length)){
+				// Key leaves the prefix early, the node moves below a new parent
+				ArtRef l = new_leaf(t, key, value);
+				if(!l){ return AllocatorError::OutOfMemory; }
+				ArtNode* parent = new_node(t, ArtNodeType::Node4);
+				if(!parent){
+					free_leaf(t, l);
+					return AllocatorError::OutOfMemory;
+				}
+				parent->prefix_length = u32(mismatch);
+				mem_copy_no_overlap(parent->prefix, n->prefix, min(mismatch, art_max_prefix));
+
+				byte b;
+				if(isize(n->prefix_length) <= art_max_prefix){
+					b = n->prefix[mismatch];
+					n->prefix_length -= u32(mismatch + 1);
+					mem_copy(n->prefix, n->prefix + mismatch + 1, n->prefix_length);
+				}
+				else {
+					String full = leaf_key(minimum<V>(*ref));
+					b = full[depth + mismatch];
+					n->prefix_length -= u32(mismatch + 1);
+					mem_copy_no_overlap(n->prefix, raw_data(full) + depth + mismatch + 1, min(isize(n->prefix_length), art_max_prefix));
+				}
+
+				ArtRef parent_ref = ArtRef(parent);
+				add_child(t, &parent_ref, b, *ref);
+				if(len(key) == depth + mismatch){ parent->terminal = l; }
+				else { add_child(t, &parent_ref, key[depth + mismatch], l); }
+
+				*ref = parent_ref;
+				*inserted = true;
+				return {};
+			}
+			depth += n->prefix_length;
+		}
+
+		if(depth == len(key)){
+			return insert_rec(t, &n->terminal, key, depth, value, inserted);
+		}
+
+		ArtRef* child = find_child(n, key[depth]);
+		if(child){
+			return insert_rec(t, child, key, depth + 1, value, inserted);
+		}
+
+		ArtRef l = new_leaf(t, key, value);
+		if(!l){ return AllocatorError::OutOfMemory; }
+		auto err = add_child(t, ref, key[depth], l);
+		if(!ok(err)){
+			free_leaf(t, l);
+			return err;
+		}
+		*inserted = true;
+		return {};
+	}
+
+	// Move the node into a smaller size class once it gets sparse, and
+	// collapse nodes left with a single path. Failing to allocate the smaller
+	// node is harmless, the current one is kept.
+	template<typename V>
+	void shrink(ArtTree<V>* t, ArtRef* ref){
+		ArtNode* n = node_of(*ref);
+		switch(n->type){
+			case ArtNodeType::Node4: {
+				auto n4 = (ArtNode4*)n;
+				if(n->count == 0){
+					*ref = n->terminal;
+					free_node(t, n);
+				}
+				else if(n->count == 1 && !n->terminal){
+					ArtRef child = n4->children[0];
+					if(!is_leaf(child)){
+						// Merge our prefix and the edge byte into the child's prefix
+						ArtNode* c = node_of(child);
+						byte merged[art_max_prefix];
+						isize m = min(isize(n->prefix_length), art_max_prefix);
+						mem_copy_no_overlap(merged, n->prefix, m);
+						if(m < art_max_prefix){
+							merged[m] = n4->keys[0];
+							m += 1;
+						}
+						isize rest = min(isize(c->prefix_length), art_max_prefix - m);
+						mem_copy_no_overlap(merged + m, c->prefix, rest);
+						mem_copy_no_overlap(c->prefix, merged, m + rest);
+						c->prefix_length += n->prefix_length + 1;
+					}
+					*ref = child;
+					free_node(t, n);
+				}
+			} break;
+			case ArtNodeType::Node16: {
+				auto n16 = (ArtNode16*)n;
+				if(n->count > 3){ break; }
+				auto n4 = (ArtNode4*)new_node(t, ArtNodeType::Node4);
+				if(!n4){ break; }
+				copy_header(n4, n);
+				mem_copy_no_overlap(n4->keys, n16->keys, n->count);
+				mem_copy_no_overlap(n4->children, n16->children, n->count * isize(sizeof(ArtRef)));
+				free_node(t, n);
+				*ref = ArtRef(n4);
+			} break;
+			case ArtNodeType::Node48: {
+				auto n48 = (ArtNode48*)n;
+				if(n->count > 12){ break; }
+				auto n16 = (ArtNode16*)new_node(t, ArtNodeType::Node16);
+				if(!n16){ break; }
+				copy_header(n16, n);
+				isize k = 0;
+				for(isize i = 0; i < 256; i += 1){
+					if(n48->index[i]){
+						n16->keys[k] = byte(i);
+						n16->children[k] = n48->children[n48->index[i] - 1];
+						k += 1;
+					}
+				}
+				free_node(t, n);
+				*ref = ArtRef(n16);
+			} break;
+			case ArtNodeType::Node256: {
+				auto n256 = (ArtNode256*)n;
+				if(n->count > 37){ break; }
+				auto n48 = (ArtNode48*)new_node(t, ArtNodeType::Node48);
+				if(!n48){ break; }
+				copy_header(n48, n);
+				isize k = 0;
+				for(isize i = 0; i < 256; i += 1){
+					if(n256->children[i]){
+						n48->children[k] = n256->children[i];
+						n48->index[i] = u8(k + 1);
+						k += 1;
+					}
+				}
+				free_node(t, n);
+				*ref = ArtRef(n48);
+			} break;
+		}
+	}
+
+	template<typename V>
+	bool remove_rec(ArtTree<V>* t, ArtRef* ref, String key, isize depth){
+		if(*ref == 0){ return false; }
+
+		if(is_leaf(*ref)){
+			if(leaf_key(leaf_of<V>(*ref)) != key){ return false; }
+			free_leaf(t, *ref);
+			*ref = 0;
+			return true;
+		}
+
+		ArtNode* n = node_of(*ref);
+		if(n->prefix_length){
+			if(check_prefix(n, key, depth) != min(isize(n->prefix_length), art_max_prefix)){ return false; }
+			depth += n->prefix_length;
+		}
+		if(depth > len(key)){ return false; }
+
+		if(depth == len(key)){
+			if(!remove_rec(t, &n->terminal, key, depth)){ return false; }
+			shrink(t, ref);
+			return true;
+		}
+
+		byte b = key[depth];
+		ArtRef* child = find_child(n, b);
+		if(!child || !remove_rec(t, child, key, depth + 1)){ return false; }
+		if(*child == 0){
+			remove_child(n, b);
+			shrink(t, ref);
+		}
+		return true;
+	}
+
+	template<typename V>
+	void destroy_rec(ArtTree<V>* t, ArtRef r){
+		if(r == 0){ return; }
+		if(is_leaf(r)){
+			free_leaf(t, r);
+			return;
+		}
+		ArtNode* n = node_of(r);
+		destroy_rec(t, n->terminal);
+		switch(n->type){
+			case ArtNodeType::Node4:   for(isize i = 0; i < n->count; i += 1){ destroy_rec(t, ((ArtNode4*)n)->children[i]); } break;
+			case ArtNodeType::Node16:  for(isize i = 0; i < n->count; i += 1){ destroy_rec(t, ((ArtNode16*)n)->children[i]); } break;
+			case ArtNodeType::Node48:  for(isize i = 0; i < 48; i += 1){ destroy_rec(t, ((ArtNode48*)n)->children[i]); } break;
+			case ArtNodeType::Node256: for(isize i = 0; i < 256; i += 1){ destroy_rec(t, ((ArtNode256*)n)->children[i]); } break;
+		}
+		free_node(t, n);
+	}
+
+	template<typename V, typename F>
+	void for_each_rec(ArtRef r, F& f){
+		if(is_leaf(r)){
+			auto l = leaf_of<V>(r);
+			f(leaf_key(l), l->value);
+			return;
+		}
+		ArtNode* n = node_of(r);
+		if(n->terminal){ for_each_rec<V>(n->terminal, f); }
+		switch(n->type){
+			case ArtNodeType::Node4:  for(isize i = 0; i < n->count; i += 1){ for_each_rec<V>(((ArtNode4*)n)->children[i], f); } break;
+			case ArtNodeType::Node16: for(isize i = 0; i < n->count; i += 1){ for_each_rec<V>(((ArtNode16*)n)->children[i], f); } break;
+			case ArtNodeType::Node48: {
+				auto n48 = (ArtNode48*)n;
+				for(isize i = 0; i < 256; i += 1){
+					if(n48->index[i]){ for_each_rec<V>(n48->children[n48->index[i] - 1], f); }
+				}
+			} break;
+			case ArtNodeType::Node256: {
+				auto n256 = (ArtNode256*)n;
+				for(isize i = 0; i < 256; i += 1){
+					if(n256->children[i]){ for_each_rec<V>(n256->children[i], f); }
+				}
+			} break;
+		}
+	}
+}
+
+template<typename V>
+void destroy(ArtTree<V>* t){
+	impl_art::destroy_rec(t, t->_root);
+	t->_root = 0;
+	t->_length = 0;
+}
+
+template<typename V>
+V* find(ArtTree<V>* t, String key){
+	using namespace impl_art;
+	ArtRef r = t->_root;
+	isize depth = 0;
+	while(r){
+		if(is_leaf(r)){
+			auto l = leaf_of<V>(r);
+			return leaf_key(l) == key ? &l->value : nullptr;
+		}
+		ArtNode* n = node_of(r);
+		if(n->prefix_length){
+			if(check_prefix(n, key, depth) != min(isize(n->prefix_length), art_max_prefix)){ return nullptr; }
+			depth += n->prefix_length;
+		}
+		if(depth > len(key)){ return nullptr; }
+		if(depth == len(key)){
+			r = n->terminal;
+			continue;
+		}
+		ArtRef* child = find_child(n, key[depth]);
+		if(!child){ return nullptr; }
+		r = *child;
+		depth += 1;
+	}
+	return nullptr;
+}
+
+// Insert or overwrite the value associated with key
+template<typename V>
+AllocatorError insert(ArtTree<V>* t, String key, V value){
+	bool inserted = false;
+	auto err = impl_art::insert_rec(t, &t->_root, key, 0, value, &inserted);
+	if(inserted){ t->_length += 1; }
+	return err;
+}
+
+template<typename V>
+bool remove(ArtTree<V>* t, String key){
+	bool removed = impl_art::remove_rec(t, &t->_root, key, 0);
+	if(removed){ t->_length -= 1; }
+	return removed;
+}
+
+// Calls f(key, value) for every element in key order
+template<typename V, typename F>
+void for_each(ArtTree<V>* t, F&& f){
+	if(t->_root){ impl_art::for_each_rec<V>(t->_root, f); }
+}
+
+// Calls f(key, value) in key order for every key starting with `prefix`
+template<typename V, typename F>
+void for_each_prefix(ArtTree<V>* t, String prefix, F&& f){
+	using namespace impl_art;
+	ArtRef r = t->_root;
+	isize depth = 0;
+	while(r){
+		if(is_leaf(r)){
+			auto l = leaf_of<V>(r);
+			if(str_starts_with(leaf_key(l), prefix)){ f(leaf_key(l), l->value); }
+			return;
+		}
+		ArtNode* n = node_of(r);
+		isize matched = check_prefix(n, prefix, depth);
+		if(depth + isize(n->prefix_length) >= len(prefix)){
+			// The prefix ends within this node, every key below matches if one does
+			if(matched == min(isize(n->prefix_length), len(prefix) - depth, art_max_prefix) &&
+			   str_starts_with(leaf_key(minimum<V>(r)), prefix)){
+				for_each_rec<V>(r, f);
+			}
+			return;
+		}
+		if(matched != min(isize(n->prefix_length), art_max_prefix)){ return; }
+		depth += n->prefix_length;
+		ArtRef* child = find_child(n, prefix[depth]);
+		if(!child){ return; }
+		r = *child;
+		depth += 1;
+	}
+}
+
+//// String Interning
+// Stores every distinct string once and maps it to a compact id, interned
+// strings can then be compared and hashed through their id alone. Id 0 is
+// always the empty string. Interned bytes are null terminated and keep their
+// address until the interner is destroyed.
+constexpr isize interner_block_size = 64 * mem_KiB;
+
+struct StringInterner {
+	HashMap<String, u32>  _ids;
+	DynamicArray<String>  _strings;
+	DynamicArray<Slice<byte>> _blocks;
+	Arena                 _block; // Current block strings get copied into
+	Allocator             _allocator;
+};
+
+StringInterner make_string_interner(Allocator allocator);
+
+void destroy(StringInterner* in);
+
+[[nodiscard]]
+Result<u32, AllocatorError> intern(StringInterner* in, String s);
+
+// Id of an already interned string, false if it was never interned.
+bool lookup(StringInterner* in, String s, u32* id);
+
+String interned_string(StringInterner const* in, u32 id);
+
+static inline
+isize len(StringInterner const& in){ return in._strings._length; }
+
+// Thread safe variant. Lookups of already interned strings are lock free, new
+// strings are copied in under a lock. The id table grows in chunks that never
+// move, so resolving an id is lock free as well.
+constexpr isize concurrent_interner_first_chunk = 1024;
+constexpr isize concurrent_interner_max_chunks  = 23; /* Enough to address every u32 id */
+
+struct ConcurrentStringInterner {
+	ConcurrentHashMap<String, u32> _ids;
+	Atomic<String*>       _chunks[concurrent_interner_max_chunks];
+	Atomic<u32>           _count;
+	SpinLock              _lock;
+	DynamicArray<Slice<byte>> _blocks;
+	Arena                 _block;
+	Allocator             _allocator;
+};
+
+void concurrent_string_interner_init(ConcurrentStringInterner* in, Allocator allocator);
+
+void destroy(ConcurrentStringInterner* in);
+
+[[nodiscard]]
+Result<u32, AllocatorError> intern(ConcurrentStringInterner* in, String s);
+
+bool lookup(ConcurrentStringInterner* in, String s, u32* id);
+
+String interned_string(ConcurrentStringInterner* in, u32 id);
+
+//// Rope
+// Editable text as an AVL balanced tree of chunks. Leaves hold up to
+// `rope_leaf_size` bytes of UTF-8, every node caches the byte, rune and line
+// counts of its subtree, so edits and offset conversions are O(log n) instead
+// of copying the whole buffer. Byte offsets passed in must fall on rune
+// boundaries. Leaves and inner nodes each have a fixed size, which plays well
+// with pool allocators.
+constexpr isize rope_leaf_size = 1024;
+
+struct RopeNode {
+	RopeNode* left;  // Both null for leaves
+	RopeNode* right;
+	isize     bytes;
+	isize     runes;
+	isize     lines; // Number of '\n'
+	i32       height;
+	// Leaves are followed by rope_leaf_size bytes of text
+};
+
+struct Rope {
+	RopeNode* _root;
+	RopeNode* _spare; // Free inner nodes, linked through `left`
+	isize     _spare_count;
+	Allocator _allocator;
+};
+
+Rope make_rope(Allocator allocator);
+
+void destroy(Rope* r);
+
+static inline
+isize len(Rope const& r){ return r._root ? r._root->bytes : 0; }
+
+static inline
+isize rope_rune_count(Rope const& r){ return r._root ? r._root->runes : 0; }
+
+// Lines are separated by '\n', an empty rope has one line
+static inline
+isize rope_line_count(Rope const& r){ return (r._root ? r._root->lines : 0) + 1; }
+
+[[nodiscard]]
+AllocatorError rope_insert(Rope* r, isize at, String text);
+
+[[nodiscard]]
+AllocatorError rope_append(Rope* r, String text);
+
+// Remove the bytes in [from, to)
+[[nodiscard]]
+AllocatorError rope_remove(Rope* r, isize from, isize to);
+
+// Move everything from `at` onwards into a new rope using the same allocator
+[[nodiscard]]
+Result<Rope, AllocatorError> rope_split(Rope* r, isize at);
+
+// Append all of `src` to `dst`, leaving `src` empty. The nodes are moved, not
+// copied, so both ropes must use the same allocator.
+[[nodiscard]]
+AllocatorError rope_concat(Rope* dst, Rope* src);
+
+byte rope_byte_at(Rope const& r, isize at);
+
+// Copy of the bytes in [from, to), null terminated
+String rope_to_string(Rope const& r, isize from, isize to, Allocator allocator);
+
+isize rope_byte_to_rune(Rope const& r, isize at);
+
+isize rope_rune_to_byte(Rope const& r, isize rune);
+
+// Line containing the byte at `at`
+isize rope_byte_to_line(Rope const& r, isize at);
+
+// Offset of the first byte of a line
+isize rope_line_to_byte(Rope const& r, isize line);
+
+namespace impl_rope {
+	static inline
+	String leaf_text(RopeNode const* n){
+		return String((byte const*)(n + 1), n->bytes);
+	}
+
+	template<typename F>
+	void for_each_chunk(RopeNode const* n, isize from, isize to, F& f){
+		if(!n->left){
+			f(leaf_text(n)[{from, to}]);
+			return;
+		}
+		isize split = n->left->bytes;
+		if(from < split){
+			for_each_chunk(n->left, from, min(to, split), f);
+		}
+		if(to > split){
+			for_each_chunk(n->right, max(from, split) - split, to - split, f);
+		}
+	}
+}
+
+// Calls f(String) on the pieces of the leaves covering [from, to), in order
+template<typename F>
+void rope_for_each_chunk(Rope const& r, isize from, isize to, F&& f){
+	bounds_check_assert(from >= 0 && from <= to && to <= len(r), "Rope range is out of bounds");
+	if(from < to){
+		impl_rope::for_each_chunk(r._root, from, to, f);
+	}
+}
+
+//// Shared Arena
+// Arena living inside of a named shared memory object or a memfd. Every
+// process that maps it may allocate from it concurrently. The mapping address
+// differs between processes, so anything stored inside of it must refer to
+// other data by offset (see SharedSlice), never by pointer.
+struct SharedArenaHeader {
+	Atomic<u64>   magic;
+	isize         capacity;
+	Atomic<isize> offset;
+	Atomic<isize> root; // Offset of a user defined entry point, 0 if none
+};
+
+static_assert(Atomic<isize>::is_always_lock_free && Atomic<u64>::is_always_lock_free, "Shared arena atomics must be address free");
+
+struct SharedArena {
+	SharedArenaHeader* header;
+	isize mapped_size;
+	i32 fd;
+	AllocatorError last_error;
+};
+
+enum struct SharedArenaError : u8 {
+	None       = 0,
+	BadName    = 1,
+	OpenFailed = 2,
+	MapFailed  = 3,
+	BadHeader  = 4,
+};
+
+// Create a new shared memory object of `size` bytes, fails if it already exists.
+SharedArenaError shared_arena_create(SharedArena* a, String name, isize size);
+
+// Create a shared arena of `size` bytes on an already open, empty file
+// descriptor (e.g. from memfd_create), takes ownership of the descriptor.
+SharedArenaError shared_arena_create_fd(SharedArena* a, i32 fd, isize size);
+
+// Map an existing shared arena created by another process. If the creator is
+// still initializing it this waits (about a second at most) for it to finish.
+SharedArenaError shared_arena_open(SharedArena* a, String name);
+
+// Map a shared arena from an already open file descriptor (e.g. a memfd
+// received from another process), takes ownership of the descriptor.
+SharedArenaError shared_arena_open_fd(SharedArena* a, i32 fd);
+
+void shared_arena_close(SharedArena* a);
+
+// Remove the name, the memory lives on until every process has closed it.
+void shared_arena_unlink(String name);
+
+// Memory is never reused, so it is always zero filled.
+void* shared_arena_alloc(SharedArena* a, isize size, isize align);
+
+Allocator shared_arena_allocator(SharedArena* a);
+
+static inline
+isize shared_arena_offset(SharedArena* a, void const* p){
+	if(p == nullptr){ return 0; }
+	isize off = (uintptr)p - (uintptr)a->header;
+	bounds_check_assert(off > 0 && off < a->header->capacity, "Pointer is not owned by shared arena");
+	return off;
+}
+
+static inline
+void* shared_arena_pointer(SharedArena* a, isize offset){
+	if(offset == 0){ return nullptr; }
+	bounds_check_assert(offset > 0 && offset < a->header->capacity, "Offset is out of shared arena bounds");
+	return (byte*)a->header + offset;
+}
+
+static inline
+void shared_arena_set_root(SharedArena* a, void const* p){
+	a->header->root.store(shared_arena_offset(a, p), std::memory_order_release);
+}
+
+static inline
+void* shared_arena_root(SharedArena* a){
+	return shared_arena_pointer(a, a->header->root.load(std::memory_order_acquire));
+}
+
+// Position independent Slice, valid in any process that maps the same arena.
+template<typename T>
+struct SharedSlice {
+	isize offset;
+	isize length;
+};
+
+struct SharedString {
+	isize offset;
+	isize length;
+};
+
+template<typename T>
+SharedSlice<T> shared_slice(SharedArena* a, Slice<T> s){
+	return { shared_arena_offset(a, raw_data(s)), len(s) };
+}
+
+template<typename T>
+Slice<T> shared_resolve(SharedArena* a, SharedSlice<T> s){
+	bounds_check_assert(s.offset + isize(sizeof(T)) * s.length <= a->header->capacity, "Shared slice is out of shared arena bounds");
+	return Slice<T>((T*)shared_arena_pointer(a, s.offset), s.length);
+}
+
+static inline
+SharedString shared_string(SharedArena* a, String s){
+	return { shared_arena_offset(a, raw_data(s)), len(s) };
+}
+
+static inline
+String shared_resolve(SharedArena* a, SharedString s){
+	bounds_check_assert(s.offset + s.length <= a->header->capacity, "Shared string is out of shared arena bounds");
+	return String((byte const*)shared_arena_pointer(a, s.offset), s.length);
+}
+
+//// Allocation Profiler
+// Sampling allocator wrapper, on average one allocation every `sample_period`
+// bytes has its call stack recorded. Stacks are captured by walking frame
+// pointers, so build with -fno-omit-frame-pointer for meaningful results.
+constexpr isize alloc_profiler_max_depth = 32;
+
+struct AllocProfilerStack {
+	u64     hash;
+	i32     depth;
+	isize   count; // Sampled allocations
+	isize   bytes; // Estimate of the bytes allocated from this stack
+	uintptr frames[alloc_profiler_max_depth];
+};
+
+struct AllocProfiler {
+	Allocator     parent;
+	isize         sample_period;
+	Atomic<isize> bytes_until_sample;
+	u64           rng_state;
+	SpinLock      lock;
+	Slice<AllocProfilerStack> stacks;
+	isize         stack_count;
+	isize         dropped; // Samples lost because the stack table was full
+};
+
+void alloc_profiler_init(AllocProfiler* p, Allocator parent, isize sample_period, isize max_stacks = 4096);
+
+void alloc_profiler_destroy(AllocProfiler* p);
+
+void alloc_profiler_reset(AllocProfiler* p);
+
+Allocator alloc_profiler_allocator(AllocProfiler* p);
+
+// Dump in collapsed stack format ("root;...;leaf bytes" per line) as
+// understood by flamegraph.pl, speedscope and pprof's importer. The result is
+// allocated like str_clone(), free it as len(s) + 1 bytes.
+String alloc_profiler_dump_collapsed(AllocProfiler* p, Allocator out);
 
 //// Heap allocator (configurable)
 Allocator heap_allocator();
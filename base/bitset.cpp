@@ -0,0 +1,234 @@
+#include "base.hpp"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// 256 bit vectors, lowered to whatever the target has (AVX2, 2xSSE2, NEON, ...)
+typedef u64 u64x4 __attribute__((vector_size(32)));
+
+// Mask of the valid bits in the last word
+static inline
+u64 bits_tail_mask(isize length){
+	isize rem = length & 63;
+	return rem == 0 ? ~u64(0) : (u64(1) << rem) - 1;
+}
+
+// Position of the n-th (from 0) set bit of a word
+static inline
+isize word_select(u64 w, isize n){
+#if defined(__BMI2__)
+	return __builtin_ctzll(_pdep_u64(u64(1) << n, w));
+#else
+	for(isize i = 0; i < n; i += 1){
+		w &= w - 1;
+	}
+	return __builtin_ctzll(w);
+#endif
+}
+
+BitSet bits_from(Slice<u64> words, isize bit_count){
+	ensure(len(words) >= bits_word_count(bit_count), "Not enough words for bit set");
+	BitSet b = {
+		.words = words[{0, bits_word_count(bit_count)}],
+		.length = bit_count,
+	};
+	if(isize n = len(b.words); n > 0){
+		raw_data(b.words)[n - 1] &= bits_tail_mask(bit_count);
+	}
+	return b;
+}
+
+BitSet make_bit_set(isize bit_count, Allocator allocator){
+	auto words = make<u64>(bits_word_count(bit_count), allocator);
+	BitSet b = {
+		.words = words,
+		.length = len(words) > 0 ? bit_count : 0,
+	};
+	return b;
+}
+
+void destroy(BitSet b, Allocator allocator){
+	destroy(b.words, allocator);
+}
+
+void bits_clear(BitSet* b){
+	mem_set(raw_data(b->words), 0, len(b->words) * sizeof(u64));
+}
+
+void bits_fill(BitSet* b){
+	isize n = len(b->words);
+	if(n == 0){ return; }
+	mem_set(raw_data(b->words), 0xff, n * sizeof(u64));
+	raw_data(b->words)[n - 1] &= bits_tail_mask(b->length);
+}
+
+#define BITS_BULK_OP(Name, Expr) \
+void Name(BitSet* dst, BitSet const& src){ \
+	ensure(dst->length == src.length, "Mismatched bit set lengths"); \
+	u64* d = raw_data(dst->words); \
+	u64 const* s = raw_data(src.words); \
+	isize n = len(dst->words); \
+	isize i = 0; \
+	for(; i + 4 <= n; i += 4){ \
+		u64x4 a, b; \
+		mem_copy_no_overlap(&a, &d[i], sizeof(a)); \
+		mem_copy_no_overlap(&b, &s[i], sizeof(b)); \
+		a = Expr; \
+		mem_copy_no_overlap(&d[i], &a, sizeof(a)); \
+	} \
+	for(; i < n; i += 1){ \
+		u64 a = d[i]; \
+		u64 b = s[i]; \
+		d[i] = Expr; \
+	} \
+}
+
+BITS_BULK_OP(bits_and,    a & b)
+BITS_BULK_OP(bits_or,     a | b)
+BITS_BULK_OP(bits_xor,    a ^ b)
+BITS_BULK_OP(bits_andnot, a & ~b)
+
+#undef BITS_BULK_OP
+
+static
+isize popcount_words(u64 const* w, isize n){
+	isize c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+	isize i = 0;
+	for(; i + 4 <= n; i += 4){
+		c0 += __builtin_popcountll(w[i + 0]);
+		c1 += __builtin_popcountll(w[i + 1]);
+		c2 += __builtin_popcountll(w[i + 2]);
+		c3 += __builtin_popcountll(w[i + 3]);
+	}
+	for(; i < n; i += 1){
+		c0 += __builtin_popcountll(w[i]);
+	}
+	return c0 + c1 + c2 + c3;
+}
+
+isize bits_count(BitSet const& b){
+	return popcount_words(raw_data(b.words), len(b.words));
+}
+
+isize bits_next_set(BitSet const& b, isize from){
+	if(from < 0){ from = 0; }
+	if(from >= b.length){ return -1; }
+
+	u64 const* w = raw_data(b.words);
+	isize n = len(b.words);
+	isize i = from >> 6;
+	u64 word = w[i] & (~u64(0) << (from & 63));
+	for(;;){
+		if(word != 0){
+			return (i << 6) + __builtin_ctzll(word);
+		}
+		i += 1;
+		if(i >= n){ return -1; }
+		word = w[i];
+	}
+}
+
+isize bits_next_unset(BitSet const& b, isize from){
+	if(from < 0){ from = 0; }
+	if(from >= b.length){ return -1; }
+
+	u64 const* w = raw_data(b.words);
+	isize n = len(b.words);
+	isize i = from >> 6;
+	u64 word = ~w[i] & (~u64(0) << (from & 63));
+	for(;;){
+		if(i == n - 1){
+			word &= bits_tail_mask(b.length);
+		}
+		if(word != 0){
+			return (i << 6) + __builtin_ctzll(word);
+		}
+		i += 1;
+		if(i >= n){ return -1; }
+		word = ~w[i];
+	}
+}
+
+isize bits_rank(BitSet const& b, isize idx){
+	bounds_check_assert(idx >= 0 && idx <= b.length, "Rank index is out of bounds");
+	u64 const* w = raw_data(b.words);
+	isize count = popcount_words(w, idx >> 6);
+	if(idx & 63){
+		count += __builtin_popcountll(w[idx >> 6] & ((u64(1) << (idx & 63)) - 1));
+	}
+	return count;
+}
+
+isize bits_select(BitSet const& b, isize n){
+	if(n < 0){ return -1; }
+	u64 const* w = raw_data(b.words);
+	for(isize i = 0; i < len(b.words); i += 1){
+		isize c = __builtin_popcountll(w[i]);
+		if(n < c){
+			return (i << 6) + word_select(w[i], n);
+		}
+		n -= c;
+	}
+	return -1;
+}
+
+BitSetRank make_bit_set_rank(BitSet const& b, Allocator allocator){
+	isize word_count = len(b.words);
+	isize block_count = (word_count + bits_rank_block_words - 1) / bits_rank_block_words;
+	BitSetRank r = {
+		.blocks = make<isize>(block_count + 1, allocator),
+	};
+	if(len(r.blocks) == 0){ return r; }
+
+	u64 const* w = raw_data(b.words);
+	isize total = 0;
+	for(isize i = 0; i < block_count; i += 1){
+		r.blocks[i] = total;
+		isize start = i * bits_rank_block_words;
+		total += popcount_words(&w[start], min(bits_rank_block_words, word_count - start));
+	}
+	r.blocks[block_count] = total;
+	return r;
+}
+
+void destroy(BitSetRank r, Allocator allocator){
+	destroy(r.blocks, allocator);
+}
+
+isize bits_rank(BitSet const& b, BitSetRank const& r, isize idx){
+	bounds_check_assert(idx >= 0 && idx <= b.length, "Rank index is out of bounds");
+	u64 const* w = raw_data(b.words);
+	isize word = idx >> 6;
+	isize block = word / bits_rank_block_words;
+	isize count = r.blocks[block];
+	count += popcount_words(&w[block * bits_rank_block_words], word - block * bits_rank_block_words);
+	if(idx & 63){
+		count += __builtin_popcountll(w[word] & ((u64(1) << (idx & 63)) - 1));
+	}
+	return count;
+}
+
+isize bits_select(BitSet const& b, BitSetRank const& r, isize n){
+	isize block_count = len(r.blocks) - 1;
+	if(n < 0 || block_count < 0 || n >= r.blocks[block_count]){ return -1; }
+
+	// Last block whose starting rank is <= n
+	isize lo = 0, hi = block_count - 1;
+	while(lo < hi){
+		isize mid = (lo + hi + 1) / 2;
+		if(r.blocks[mid] <= n){ lo = mid; }
+		else { hi = mid - 1; }
+	}
+
+	n -= r.blocks[lo];
+	u64 const* w = raw_data(b.words);
+	for(isize i = lo * bits_rank_block_words; i < len(b.words); i += 1){
+		isize c = __builtin_popcountll(w[i]);
+		if(n < c){
+			return (i << 6) + word_select(w[i], n);
+		}
+		n -= c;
+	}
+	return -1;
+}
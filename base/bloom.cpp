@@ -0,0 +1,144 @@
+#include "base.hpp"
+
+// 8 lanes of 32/64 bits, lowered to whatever the target has
+typedef u32 u32x8 __attribute__((vector_size(32)));
+typedef u64 u64x8 __attribute__((vector_size(64)));
+
+static_assert(sizeof(u64x8) == cache_line_size, "Bloom filter block must be one cache line");
+
+// Odd multipliers, one per word of a block
+static const u32x8 bloom_salts = {
+	0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+	0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+constexpr u64 bloom_magic = 0x314d4f4f4c42; // "BLOOM1"
+
+struct BloomFilterHeader {
+	u64 magic;
+	u64 block_count;
+	u64 _reserved[6];
+};
+
+static_assert(sizeof(BloomFilterHeader) == cache_line_size, "Header must keep blocks cache line aligned");
+
+// Upper half of the hash picks the block, lower half the bits inside it
+static inline
+u64* bloom_block(BloomFilter const& f, u64 hash){
+	u64 idx = ((hash >> 32) * u64(f.block_count)) >> 32;
+	return &f.blocks[idx * bloom_block_words];
+}
+
+static inline
+void bloom_mask(u64 hash, u64x8* mask){
+	u32x8 h = u32x8{} + u32(hash);
+	u32x8 bit = (h * bloom_salts) >> 26;
+	*mask = (u64x8{} + 1) << __builtin_convertvector(bit, u64x8);
+}
+
+static inline
+bool bloom_block_contains(u64 const* block, u64 hash){
+	u64x8 mask, b;
+	bloom_mask(hash, &mask);
+	mem_copy_no_overlap(&b, block, sizeof(b));
+	u64x8 missing = mask & ~b;
+	u64 any = 0;
+	for(isize i = 0; i < bloom_block_words; i += 1){
+		any |= missing[i];
+	}
+	return any == 0;
+}
+
+Result<BloomFilter, AllocatorError> make_bloom_filter(isize expected_items, isize bits_per_item, Allocator allocator){
+	isize bits = max(expected_items, isize(1)) * max(bits_per_item, isize(1));
+	isize block_count = (bits + cache_line_size * 8 - 1) / (cache_line_size * 8);
+
+	BloomFilter f = {};
+	auto [p, err] = mem_alloc(allocator, block_count * cache_line_size, cache_line_size);
+	if(!p){ return { f, err }; }
+	f.blocks = (u64*)p;
+	f.block_count = block_count;
+	bloom_clear(&f);
+	return { f };
+}
+
+void destroy(BloomFilter f, Allocator allocator){
+	if(!f.blocks){ return; }
+	mem_free(allocator, f.blocks, f.block_count * cache_line_size, cache_line_size);
+}
+
+void bloom_clear(BloomFilter* f){
+	if(!f->blocks){ return; }
+	mem_set(f->blocks, 0, f->block_count * cache_line_size);
+}
+
+void bloom_insert(BloomFilter* f, u64 hash){
+	if(!f->blocks){ return; }
+	u64* block = bloom_block(*f, hash);
+	u64x8 mask, b;
+	bloom_mask(hash, &mask);
+	mem_copy_no_overlap(&b, block, sizeof(b));
+	b |= mask;
+	mem_copy_no_overlap(block, &b, sizeof(b));
+}
+
+bool bloom_contains(BloomFilter const& f, u64 hash){
+	if(!f.blocks){ return true; }
+	return bloom_block_contains(bloom_block(f, hash), hash);
+}
+
+isize bloom_contains_batch(BloomFilter const& f, Slice<u64> hashes, Slice<bool> out){
+	ensure(len(out) >= len(hashes), "Not enough room for bloom filter results");
+	constexpr isize prefetch_distance = 8;
+	isize n = len(hashes);
+	u64 const* h = raw_data(hashes);
+	bool* res = raw_data(out);
+
+	if(!f.blocks){
+		mem_set(res, 1, n * isize(sizeof(bool)));
+		return n;
+	}
+
+	for(isize i = 0; i < min(n, prefetch_distance); i += 1){
+		__builtin_prefetch(bloom_block(f, h[i]));
+	}
+
+	isize hits = 0;
+	for(isize i = 0; i < n; i += 1){
+		if(i + prefetch_distance < n){
+			__builtin_prefetch(bloom_block(f, h[i + prefetch_distance]));
+		}
+		bool found = bloom_block_contains(bloom_block(f, h[i]), h[i]);
+		res[i] = found;
+		hits += found;
+	}
+	return hits;
+}
+
+isize bloom_serialized_size(BloomFilter const& f){
+	return isize(sizeof(BloomFilterHeader)) + f.block_count * cache_line_size;
+}
+
+bool bloom_serialize(BloomFilter const& f, Slice<byte> out){
+	if(len(out) < bloom_serialized_size(f)){ return false; }
+	BloomFilterHeader header = {};
+	header.magic = bloom_magic;
+	header.block_count = u64(f.block_count);
+	mem_copy_no_overlap(raw_data(out), &header, sizeof(header));
+	mem_copy_no_overlap(raw_data(out) + sizeof(header), f.blocks, f.block_count * cache_line_size);
+	return true;
+}
+
+bool bloom_view(Slice<byte> bytes, BloomFilter* out){
+	if(len(bytes) < isize(sizeof(BloomFilterHeader))){ return false; }
+	ensure((uintptr(raw_data(bytes)) & 7) == 0, "Bloom filter bytes must be 8 byte aligned");
+
+	BloomFilterHeader header;
+	mem_copy_no_overlap(&header, raw_data(bytes), sizeof(header));
+	if(header.magic != bloom_magic || header.block_count == 0){ return false; }
+	if(header.block_count > u64(len(bytes) - isize(sizeof(header))) / cache_line_size){ return false; }
+
+	out->blocks = (u64*)(raw_data(bytes) + sizeof(header));
+	out->block_count = isize(header.block_count);
+	return true;
+}
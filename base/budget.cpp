@@ -0,0 +1,141 @@
+#include "base.hpp"
+
+void budget_init(Budget* b, isize limit, Budget* parent){
+	b->used.store(0, std::memory_order_relaxed);
+	b->limit = limit;
+	b->parent = parent;
+	b->reclaim = nullptr;
+	b->reclaim_data = nullptr;
+}
+
+void budget_set_reclaim(Budget* b, BudgetReclaimFunc func, void* data){
+	b->reclaim = func;
+	b->reclaim_data = data;
+}
+
+void budget_release(Budget* b, isize size){
+	for(Budget* cur = b; cur != nullptr; cur = cur->parent){
+		cur->used.fetch_sub(size, std::memory_order_relaxed);
+	}
+}
+
+static
+bool budget_try_charge_one(Budget* b, isize size){
+	isize used = b->used.load(std::memory_order_relaxed);
+	do {
+		if(used + size > b->limit){ return false; }
+	} while(!b->used.compare_exchange_weak(used, used + size, std::memory_order_relaxed));
+	return true;
+}
+
+// Returns the budget that rejected the charge, nullptr on success.
+static
+Budget* budget_try_charge(Budget* b, isize size){
+	for(Budget* cur = b; cur != nullptr; cur = cur->parent){
+		if(!budget_try_charge_one(cur, size)){
+			// Roll back what was already charged below the failing budget
+			for(Budget* done = b; done != cur; done = done->parent){
+				done->used.fetch_sub(size, std::memory_order_relaxed);
+			}
+			return cur;
+		}
+	}
+	return nullptr;
+}
+
+bool budget_charge(Budget* b, isize size){
+	if(size <= 0){ return true; }
+
+	Budget* rejected = budget_try_charge(b, size);
+	if(rejected == nullptr){ return true; }
+
+	if(rejected->reclaim == nullptr){ return false; }
+	rejected->reclaim(rejected->reclaim_data, size);
+	return budget_try_charge(b, size) == nullptr;
+}
+
+static
+Result<void*, AllocatorError> budget_allocator_func(
+	void* data,
+	AllocatorMode mode,
+	isize size,
+	isize align,
+	void* old_ptr,
+	isize old_size,
+	isize old_align
+){
+	auto ba = (BudgetAllocator*)data;
+	auto b = ba->budget;
+	auto parent = ba->parent;
+	Result<void*, AllocatorError> result{0};
+
+	using M = AllocatorMode;
+
+	switch(mode){
+	case M::Alloc: {
+		if(!budget_charge(b, size)){
+			result.error = AllocatorError::OutOfMemory;
+			return result;
+		}
+		result = parent.func(parent.data, mode, size, align, old_ptr, old_size, old_align);
+		if(!ok(result)){
+			budget_release(b, size);
+		}
+		else {
+			ba->charged.fetch_add(size, std::memory_order_relaxed);
+		}
+	} break;
+
+	case M::Realloc: {
+		isize delta = size - old_size;
+		if(!budget_charge(b, delta)){
+			result.error = AllocatorError::OutOfMemory;
+			return result;
+		}
+		result = parent.func(parent.data, mode, size, align, old_ptr, old_size, old_align);
+		if(!ok(result)){
+			if(delta > 0){ budget_release(b, delta); }
+		}
+		else {
+			if(delta < 0){ budget_release(b, -delta); }
+			ba->charged.fetch_add(delta, std::memory_order_relaxed);
+		}
+	} break;
+
+	case M::Free: {
+		result = parent.func(parent.data, mode, size, align, old_ptr, old_size, old_align);
+		if(ok(result) && old_ptr != nullptr){
+			budget_release(b, old_size);
+			ba->charged.fetch_sub(old_size, std::memory_order_relaxed);
+		}
+	} break;
+
+	case M::FreeAll: {
+		// Only what went through this allocator, others may share the budget
+		result = parent.func(parent.data, mode, size, align, old_ptr, old_size, old_align);
+		if(ok(result)){
+			budget_release(b, ba->charged.exchange(0, std::memory_order_relaxed));
+		}
+	} break;
+
+	default: {
+		result = parent.func(parent.data, mode, size, align, old_ptr, old_size, old_align);
+	} break;
+	}
+
+	return result;
+}
+
+void budget_allocator_init(BudgetAllocator* ba, Budget* b, Allocator parent){
+	ba->budget = b;
+	ba->parent = parent;
+	ba->charged.store(0, std::memory_order_relaxed);
+}
+
+Allocator budget_allocator(BudgetAllocator* ba){
+	Allocator a = {
+		.data = (void*)ba,
+		.func = budget_allocator_func,
+	};
+	return a;
+}
@@ -0,0 +1,68 @@
+#include "base.hpp"
+
+// Based on wyhash (public domain, Wang Yi)
+
+constexpr u64 hash_secret[3] = {
+	0xa0761d6478bd642full,
+	0xe7037ed1a0b428dbull,
+	0x8ebc6af09c88c6e3ull,
+};
+
+static inline
+u64 hash_read64(byte const* p){
+	u64 v;
+	mem_copy_no_overlap(&v, p, 8);
+	return v;
+}
+
+static inline
+u64 hash_read32(byte const* p){
+	u32 v;
+	mem_copy_no_overlap(&v, p, 4);
+	return v;
+}
+
+u64 hash_bytes(void const* data, isize count, u64 seed){
+	auto p = (byte const*)data;
+	u64 a = 0, b = 0;
+	seed ^= hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+
+	if(count <= 16){
+		if(count >= 4){
+			isize mid = (count >> 3) << 2;
+			a = (hash_read32(p) << 32) | hash_read32(p + mid);
+			b = (hash_read32(p + count - 4) << 32) | hash_read32(p + count - 4 - mid);
+		}
+		else if(count > 0){
+			a = (u64(p[0]) << 16) | (u64(p[count >> 1]) << 8) | u64(p[count - 1]);
+		}
+	}
+	else {
+		isize i = count;
+		if(i > 48){
+			u64 s1 = seed, s2 = seed;
+			do {
+				seed = hash_mix(hash_read64(p)      ^ hash_secret[0], hash_read64(p + 8)  ^ seed);
+				s1   = hash_mix(hash_read64(p + 16) ^ hash_secret[1], hash_read64(p + 24) ^ s1);
+				s2   = hash_mix(hash_read64(p + 32) ^ hash_secret[2], hash_read64(p + 40) ^ s2);
+				p += 48;
+				i -= 48;
+			} while(i > 48);
+			seed ^= s1 ^ s2;
+		}
+		while(i > 16){
+			seed = hash_mix(hash_read64(p) ^ hash_secret[1], hash_read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = hash_read64(p + i - 16);
+		b = hash_read64(p + i - 8);
+	}
+
+	a ^= hash_secret[1];
+	b ^= seed;
+	__uint128_t r = __uint128_t(a) * __uint128_t(b);
+	a = u64(r);
+	b = u64(r >> 64);
+	return hash_mix(a ^ hash_secret[0] ^ u64(count), b ^ hash_secret[1]);
+}
@@ -0,0 +1,160 @@
+#include "base.hpp"
+
+// Copy s into the current block (null terminated), starting a new block when
+// it does not fit. Strings larger than a block get a block of their own.
+static
+String interner_store(DynamicArray<Slice<byte>>* blocks, Arena* block, Allocator allocator, String s){
+	byte* p = (byte*)arena_alloc(block, len(s) + 1, 1);
+	if(!p){
+		auto buf = make<byte>(max(interner_block_size, len(s) + 1), allocator);
+		if(len(buf) == 0){ return String(); }
+		if(!ok(append(blocks, buf))){
+			destroy(buf, allocator);
+			return String();
+		}
+		arena_init(block, buf);
+		p = (byte*)arena_alloc(block, len(s) + 1, 1);
+	}
+	mem_copy_no_overlap(p, raw_data(s), len(s));
+	p[len(s)] = 0;
+	return String(p, len(s));
+}
+
+static
+void interner_free_blocks(DynamicArray<Slice<byte>>* blocks, Allocator allocator){
+	for(isize i = 0; i < len(*blocks); i += 1){
+		destroy((*blocks)[i], allocator);
+	}
+	destroy(blocks);
+}
+
+StringInterner make_string_interner(Allocator allocator){
+	StringInterner in;
+	in._allocator = allocator;
+	in._ids = make_hash_map<String, u32>(allocator);
+	in._strings = make_dynamic_array<String>(allocator);
+	in._blocks = make_dynamic_array<Slice<byte>>(allocator, 4);
+	arena_init(&in._block, Slice<byte>());
+	append(&in._strings, String());
+	return in;
+}
+
+void destroy(StringInterner* in){
+	destroy(&in->_ids);
+	destroy(&in->_strings);
+	interner_free_blocks(&in->_blocks, in->_allocator);
+}
+
+Result<u32, AllocatorError> intern(StringInterner* in, String s){
+	if(len(s) == 0){ return { 0 }; }
+	if(auto id = find(&in->_ids, s)){ return { *id }; }
+
+	String stored = interner_store(&in->_blocks, &in->_block, in->_allocator, s);
+	if(len(stored) == 0){ return { 0, AllocatorError::OutOfMemory }; }
+
+	u32 id = u32(len(in->_strings));
+	auto err = append(&in->_strings, stored);
+	if(!ok(err)){ return { 0, err }; }
+
+	err = insert(&in->_ids, stored, id);
+	if(!ok(err)){
+		in->_strings._length -= 1;
+		return { 0, err };
+	}
+	return { id };
+}
+
+bool lookup(StringInterner* in, String s, u32* id){
+	if(len(s) == 0){
+		*id = 0;
+		return true;
+	}
+	auto p = find(&in->_ids, s);
+	if(p){ *id = *p; }
+	return p != nullptr;
+}
+
+String interned_string(StringInterner const* in, u32 id){
+	return in->_strings[id];
+}
+
+//// Concurrent
+static
+Pair<isize> concurrent_interner_position(u32 id){
+	u64 x = u64(id) / concurrent_interner_first_chunk + 1;
+	isize chunk = 63 - __builtin_clzll(x);
+	isize index = isize(id) - concurrent_interner_first_chunk * ((isize(1) << chunk) - 1);
+	return { chunk, index };
+}
+
+void concurrent_string_interner_init(ConcurrentStringInterner* in, Allocator allocator){
+	in->_allocator = allocator;
+	in->_ids = make_concurrent_hash_map<String, u32>(allocator);
+	for(isize i = 0; i < concurrent_interner_max_chunks; i += 1){
+		in->_chunks[i].store(nullptr, std::memory_order_relaxed);
+	}
+	in->_count.store(1, std::memory_order_relaxed); /* Id 0 is the empty string */
+	in->_lock._locked.store(false, std::memory_order_relaxed);
+	in->_blocks = make_dynamic_array<Slice<byte>>(allocator, 4);
+	arena_init(&in->_block, Slice<byte>());
+
+	auto first = make<String>(concurrent_interner_first_chunk, allocator);
+	in->_chunks[0].store(raw_data(first), std::memory_order_release);
+}
+
+void destroy(ConcurrentStringInterner* in){
+	destroy(&in->_ids);
+	for(isize i = 0; i < concurrent_interner_max_chunks; i += 1){
+		if(auto chunk = in->_chunks[i].load(std::memory_order_acquire)){
+			destroy(Slice<String>(chunk, concurrent_interner_first_chunk << i), in->_allocator);
+		}
+	}
+	interner_free_blocks(&in->_blocks, in->_allocator);
+}
+
+Result<u32, AllocatorError> intern(ConcurrentStringInterner* in, String s){
+	u32 id = 0;
+	if(lookup(in, s, &id)){ return { id }; }
+
+	spin_lock(&in->_lock);
+	defer(spin_unlock(&in->_lock));
+
+	// Somebody else may have interned it while we waited for the lock
+	if(lookup(in, s, &id)){ return { id }; }
+
+	id = in->_count.load(std::memory_order_relaxed);
+	auto [chunk, index] = concurrent_interner_position(id);
+	String* table = in->_chunks[chunk].load(std::memory_order_relaxed);
+	if(!table){
+		table = raw_data(make<String>(concurrent_interner_first_chunk << chunk, in->_allocator));
+		if(!table){ return { 0, AllocatorError::OutOfMemory }; }
+		in->_chunks[chunk].store(table, std::memory_order_release);
+	}
+
+	String stored = interner_store(&in->_blocks, &in->_block, in->_allocator, s);
+	if(len(stored) == 0){ return { 0, AllocatorError::OutOfMemory }; }
+	table[index] = stored;
+
+	// Publishing in the map makes the id visible to other threads, so the
+	// table entry and the count must be stored before it. If the insert fails
+	// the id is simply never handed out.
+	in->_count.store(id + 1, std::memory_order_release);
+	auto err = insert(&in->_ids, stored, id);
+	if(!ok(err)){ return { 0, err }; }
+	return { id };
+}
+
+bool lookup(ConcurrentStringInterner* in, String s, u32* id){
+	if(len(s) == 0){
+		*id = 0;
+		return true;
+	}
+	return find(&in->_ids, s, id);
+}
+
+String interned_string(ConcurrentStringInterner* in, u32 id){
+	if(id == 0){ return String(); }
+	bounds_check_assert(id < in->_count.load(std::memory_order_acquire), "Invalid interned string id");
+	auto [chunk, index] = concurrent_interner_position(id);
+	return in->_chunks[chunk].load(std::memory_order_acquire)[index];
+}
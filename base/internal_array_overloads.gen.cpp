@@ -170,64 +170,943 @@ template <typename T, int N> Array<T, N> operator~(Array<T, N> a) {
 	return r;
 }
 template <typename T, int N>
-Array<bool, N> operator&&(Array<T, N> a, Array<T, N> b) {
-	Array<bool, N> r{};
+Array<ArrayMask<T>, N> operator&&(Array<T, N> a, Array<T, N> b) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = a[i] && b[i];
+		r[i] = ArrayMask<T>(-(a[i] && b[i]));
 	return r;
 }
 template <typename T, int N>
-Array<bool, N> operator||(Array<T, N> a, Array<T, N> b) {
-	Array<bool, N> r{};
+Array<ArrayMask<T>, N> operator||(Array<T, N> a, Array<T, N> b) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = a[i] || b[i];
+		r[i] = ArrayMask<T>(-(a[i] || b[i]));
 	return r;
 }
 template <typename T, int N>
-Array<bool, N> operator==(Array<T, N> a, Array<T, N> b) {
-	Array<bool, N> r{};
+Array<ArrayMask<T>, N> operator==(Array<T, N> a, Array<T, N> b) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = a[i] == b[i];
+		r[i] = ArrayMask<T>(-(a[i] == b[i]));
 	return r;
 }
 template <typename T, int N>
-Array<bool, N> operator!=(Array<T, N> a, Array<T, N> b) {
-	Array<bool, N> r{};
+Array<ArrayMask<T>, N> operator!=(Array<T, N> a, Array<T, N> b) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = a[i] != b[i];
+		r[i] = ArrayMask<T>(-(a[i] != b[i]));
 	return r;
 }
 template <typename T, int N>
-Array<bool, N> operator>=(Array<T, N> a, Array<T, N> b) {
-	Array<bool, N> r{};
+Array<ArrayMask<T>, N> operator>=(Array<T, N> a, Array<T, N> b) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = a[i] >= b[i];
+		r[i] = ArrayMask<T>(-(a[i] >= b[i]));
 	return r;
 }
 template <typename T, int N>
-Array<bool, N> operator<=(Array<T, N> a, Array<T, N> b) {
-	Array<bool, N> r{};
+Array<ArrayMask<T>, N> operator<=(Array<T, N> a, Array<T, N> b) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = a[i] <= b[i];
+		r[i] = ArrayMask<T>(-(a[i] <= b[i]));
 	return r;
 }
 template <typename T, int N>
-Array<bool, N> operator>(Array<T, N> a, Array<T, N> b) {
-	Array<bool, N> r{};
+Array<ArrayMask<T>, N> operator>(Array<T, N> a, Array<T, N> b) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = a[i] > b[i];
+		r[i] = ArrayMask<T>(-(a[i] > b[i]));
 	return r;
 }
 template <typename T, int N>
-Array<bool, N> operator<(Array<T, N> a, Array<T, N> b) {
-	Array<bool, N> r{};
+Array<ArrayMask<T>, N> operator<(Array<T, N> a, Array<T, N> b) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = a[i] < b[i];
+		r[i] = ArrayMask<T>(-(a[i] < b[i]));
 	return r;
 }
-template <typename T, int N> Array<bool, N> operator!(Array<T, N> a) {
-	Array<bool, N> r{};
+template <typename T, int N> Array<ArrayMask<T>, N> operator!(Array<T, N> a) {
+	Array<ArrayMask<T>, N> r{};
 	for (int i = 0; i < N; i++)
-		r[i] = !a[i];
+		r[i] = ArrayMask<T>(-!a[i]);
+	return r;
+}
+// SIMD specializations for common shapes. Loads and stores go through
+// may_alias, element aligned vector types so they work on the plain T[N]
+// inside of Array. The 32 byte shapes (f32x8, i32x8, f64x4) are single
+// instructions only when building with AVX (-mavx2 or a -march that has
+// it), otherwise the compiler splits every operation in two SSE halves.
+namespace impl_array {
+typedef f32 f32x4 __attribute__((vector_size(16), aligned(4), may_alias));
+typedef i32 i32x4 __attribute__((vector_size(16), aligned(4), may_alias));
+typedef f32 f32x8 __attribute__((vector_size(32), aligned(4), may_alias));
+typedef i32 i32x8 __attribute__((vector_size(32), aligned(4), may_alias));
+typedef f64 f64x4 __attribute__((vector_size(32), aligned(8), may_alias));
+typedef i64 i64x4 __attribute__((vector_size(32), aligned(8), may_alias));
+typedef u8 u8x16 __attribute__((vector_size(16), aligned(1), may_alias));
+typedef i8 i8x16 __attribute__((vector_size(16), aligned(1), may_alias));
+} // namespace impl_array
+template <> inline Array<f32, 4> operator+(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = *(V const *)a.v + *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 4> operator+(Array<f32, 4> a, f32 s) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = *(V const *)a.v + s;
+	return r;
+}
+template <> inline Array<f32, 4> operator+(f32 s, Array<f32, 4> a) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = s + *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f32, 4> operator-(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = *(V const *)a.v - *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 4> operator-(Array<f32, 4> a, f32 s) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = *(V const *)a.v - s;
+	return r;
+}
+template <> inline Array<f32, 4> operator-(f32 s, Array<f32, 4> a) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = s - *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f32, 4> operator*(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = *(V const *)a.v * *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 4> operator*(Array<f32, 4> a, f32 s) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = *(V const *)a.v * s;
+	return r;
+}
+template <> inline Array<f32, 4> operator*(f32 s, Array<f32, 4> a) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = s * *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f32, 4> operator/(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = *(V const *)a.v / *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 4> operator/(Array<f32, 4> a, f32 s) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = *(V const *)a.v / s;
+	return r;
+}
+template <> inline Array<f32, 4> operator/(f32 s, Array<f32, 4> a) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = s / *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f32, 4> operator-(Array<f32, 4> a) {
+	using V = impl_array::f32x4;
+	Array<f32, 4> r;
+	*(V *)r.v = -*(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator==(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v == *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator!=(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v != *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator>=(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v >= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator<=(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v <= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator>(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v > *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator<(Array<f32, 4> a, Array<f32, 4> b) {
+	using V = impl_array::f32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v < *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 4> select(Array<i32, 4> mask, Array<f32, 4> a, Array<f32, 4> b) {
+	using M = impl_array::i32x4;
+	M m = *(M const *)mask.v;
+	Array<f32, 4> r;
+	*(M *)r.v = (m & *(M const *)a.v) | (~m & *(M const *)b.v);
+	return r;
+}
+template <> inline Array<f32, 8> operator+(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = *(V const *)a.v + *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 8> operator+(Array<f32, 8> a, f32 s) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = *(V const *)a.v + s;
+	return r;
+}
+template <> inline Array<f32, 8> operator+(f32 s, Array<f32, 8> a) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = s + *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f32, 8> operator-(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = *(V const *)a.v - *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 8> operator-(Array<f32, 8> a, f32 s) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = *(V const *)a.v - s;
+	return r;
+}
+template <> inline Array<f32, 8> operator-(f32 s, Array<f32, 8> a) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = s - *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f32, 8> operator*(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = *(V const *)a.v * *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 8> operator*(Array<f32, 8> a, f32 s) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = *(V const *)a.v * s;
+	return r;
+}
+template <> inline Array<f32, 8> operator*(f32 s, Array<f32, 8> a) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = s * *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f32, 8> operator/(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = *(V const *)a.v / *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 8> operator/(Array<f32, 8> a, f32 s) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = *(V const *)a.v / s;
+	return r;
+}
+template <> inline Array<f32, 8> operator/(f32 s, Array<f32, 8> a) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = s / *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f32, 8> operator-(Array<f32, 8> a) {
+	using V = impl_array::f32x8;
+	Array<f32, 8> r;
+	*(V *)r.v = -*(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator==(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v == *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator!=(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v != *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator>=(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v >= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator<=(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v <= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator>(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v > *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator<(Array<f32, 8> a, Array<f32, 8> b) {
+	using V = impl_array::f32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v < *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f32, 8> select(Array<i32, 8> mask, Array<f32, 8> a, Array<f32, 8> b) {
+	using M = impl_array::i32x8;
+	M m = *(M const *)mask.v;
+	Array<f32, 8> r;
+	*(M *)r.v = (m & *(M const *)a.v) | (~m & *(M const *)b.v);
+	return r;
+}
+template <> inline Array<f64, 4> operator+(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = *(V const *)a.v + *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f64, 4> operator+(Array<f64, 4> a, f64 s) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = *(V const *)a.v + s;
+	return r;
+}
+template <> inline Array<f64, 4> operator+(f64 s, Array<f64, 4> a) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = s + *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f64, 4> operator-(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = *(V const *)a.v - *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f64, 4> operator-(Array<f64, 4> a, f64 s) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = *(V const *)a.v - s;
+	return r;
+}
+template <> inline Array<f64, 4> operator-(f64 s, Array<f64, 4> a) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = s - *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f64, 4> operator*(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = *(V const *)a.v * *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f64, 4> operator*(Array<f64, 4> a, f64 s) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = *(V const *)a.v * s;
+	return r;
+}
+template <> inline Array<f64, 4> operator*(f64 s, Array<f64, 4> a) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = s * *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f64, 4> operator/(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = *(V const *)a.v / *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f64, 4> operator/(Array<f64, 4> a, f64 s) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = *(V const *)a.v / s;
+	return r;
+}
+template <> inline Array<f64, 4> operator/(f64 s, Array<f64, 4> a) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = s / *(V const *)a.v;
+	return r;
+}
+template <> inline Array<f64, 4> operator-(Array<f64, 4> a) {
+	using V = impl_array::f64x4;
+	Array<f64, 4> r;
+	*(V *)r.v = -*(V const *)a.v;
+	return r;
+}
+template <> inline Array<i64, 4> operator==(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	using M = impl_array::i64x4;
+	Array<i64, 4> r;
+	*(M *)r.v = *(V const *)a.v == *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i64, 4> operator!=(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	using M = impl_array::i64x4;
+	Array<i64, 4> r;
+	*(M *)r.v = *(V const *)a.v != *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i64, 4> operator>=(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	using M = impl_array::i64x4;
+	Array<i64, 4> r;
+	*(M *)r.v = *(V const *)a.v >= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i64, 4> operator<=(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	using M = impl_array::i64x4;
+	Array<i64, 4> r;
+	*(M *)r.v = *(V const *)a.v <= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i64, 4> operator>(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	using M = impl_array::i64x4;
+	Array<i64, 4> r;
+	*(M *)r.v = *(V const *)a.v > *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i64, 4> operator<(Array<f64, 4> a, Array<f64, 4> b) {
+	using V = impl_array::f64x4;
+	using M = impl_array::i64x4;
+	Array<i64, 4> r;
+	*(M *)r.v = *(V const *)a.v < *(V const *)b.v;
+	return r;
+}
+template <> inline Array<f64, 4> select(Array<i64, 4> mask, Array<f64, 4> a, Array<f64, 4> b) {
+	using M = impl_array::i64x4;
+	M m = *(M const *)mask.v;
+	Array<f64, 4> r;
+	*(M *)r.v = (m & *(M const *)a.v) | (~m & *(M const *)b.v);
+	return r;
+}
+template <> inline Array<i32, 4> operator+(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v + *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator+(Array<i32, 4> a, i32 s) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v + s;
+	return r;
+}
+template <> inline Array<i32, 4> operator+(i32 s, Array<i32, 4> a) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = s + *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator-(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v - *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator-(Array<i32, 4> a, i32 s) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v - s;
+	return r;
+}
+template <> inline Array<i32, 4> operator-(i32 s, Array<i32, 4> a) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = s - *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator*(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v * *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator*(Array<i32, 4> a, i32 s) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v * s;
+	return r;
+}
+template <> inline Array<i32, 4> operator*(i32 s, Array<i32, 4> a) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = s * *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator&(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v & *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator&(Array<i32, 4> a, i32 s) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v & s;
+	return r;
+}
+template <> inline Array<i32, 4> operator&(i32 s, Array<i32, 4> a) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = s & *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator|(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v | *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator|(Array<i32, 4> a, i32 s) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v | s;
+	return r;
+}
+template <> inline Array<i32, 4> operator|(i32 s, Array<i32, 4> a) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = s | *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator^(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v ^ *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator^(Array<i32, 4> a, i32 s) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = *(V const *)a.v ^ s;
+	return r;
+}
+template <> inline Array<i32, 4> operator^(i32 s, Array<i32, 4> a) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = s ^ *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator-(Array<i32, 4> a) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = -*(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator~(Array<i32, 4> a) {
+	using V = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(V *)r.v = ~*(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator==(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v == *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator!=(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v != *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator>=(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v >= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator<=(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v <= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator>(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v > *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> operator<(Array<i32, 4> a, Array<i32, 4> b) {
+	using V = impl_array::i32x4;
+	using M = impl_array::i32x4;
+	Array<i32, 4> r;
+	*(M *)r.v = *(V const *)a.v < *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 4> select(Array<i32, 4> mask, Array<i32, 4> a, Array<i32, 4> b) {
+	using M = impl_array::i32x4;
+	M m = *(M const *)mask.v;
+	Array<i32, 4> r;
+	*(M *)r.v = (m & *(M const *)a.v) | (~m & *(M const *)b.v);
+	return r;
+}
+template <> inline Array<i32, 8> operator+(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v + *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator+(Array<i32, 8> a, i32 s) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v + s;
+	return r;
+}
+template <> inline Array<i32, 8> operator+(i32 s, Array<i32, 8> a) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = s + *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator-(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v - *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator-(Array<i32, 8> a, i32 s) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v - s;
+	return r;
+}
+template <> inline Array<i32, 8> operator-(i32 s, Array<i32, 8> a) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = s - *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator*(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v * *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator*(Array<i32, 8> a, i32 s) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v * s;
+	return r;
+}
+template <> inline Array<i32, 8> operator*(i32 s, Array<i32, 8> a) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = s * *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator&(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v & *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator&(Array<i32, 8> a, i32 s) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v & s;
+	return r;
+}
+template <> inline Array<i32, 8> operator&(i32 s, Array<i32, 8> a) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = s & *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator|(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v | *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator|(Array<i32, 8> a, i32 s) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v | s;
+	return r;
+}
+template <> inline Array<i32, 8> operator|(i32 s, Array<i32, 8> a) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = s | *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator^(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v ^ *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator^(Array<i32, 8> a, i32 s) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = *(V const *)a.v ^ s;
+	return r;
+}
+template <> inline Array<i32, 8> operator^(i32 s, Array<i32, 8> a) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = s ^ *(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator-(Array<i32, 8> a) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = -*(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator~(Array<i32, 8> a) {
+	using V = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(V *)r.v = ~*(V const *)a.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator==(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v == *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator!=(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v != *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator>=(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v >= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator<=(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v <= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator>(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v > *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> operator<(Array<i32, 8> a, Array<i32, 8> b) {
+	using V = impl_array::i32x8;
+	using M = impl_array::i32x8;
+	Array<i32, 8> r;
+	*(M *)r.v = *(V const *)a.v < *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i32, 8> select(Array<i32, 8> mask, Array<i32, 8> a, Array<i32, 8> b) {
+	using M = impl_array::i32x8;
+	M m = *(M const *)mask.v;
+	Array<i32, 8> r;
+	*(M *)r.v = (m & *(M const *)a.v) | (~m & *(M const *)b.v);
+	return r;
+}
+template <> inline Array<u8, 16> operator+(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v + *(V const *)b.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator+(Array<u8, 16> a, u8 s) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v + s;
+	return r;
+}
+template <> inline Array<u8, 16> operator+(u8 s, Array<u8, 16> a) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = s + *(V const *)a.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator-(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v - *(V const *)b.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator-(Array<u8, 16> a, u8 s) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v - s;
+	return r;
+}
+template <> inline Array<u8, 16> operator-(u8 s, Array<u8, 16> a) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = s - *(V const *)a.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator&(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v & *(V const *)b.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator&(Array<u8, 16> a, u8 s) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v & s;
+	return r;
+}
+template <> inline Array<u8, 16> operator&(u8 s, Array<u8, 16> a) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = s & *(V const *)a.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator|(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v | *(V const *)b.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator|(Array<u8, 16> a, u8 s) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v | s;
+	return r;
+}
+template <> inline Array<u8, 16> operator|(u8 s, Array<u8, 16> a) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = s | *(V const *)a.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator^(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v ^ *(V const *)b.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator^(Array<u8, 16> a, u8 s) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = *(V const *)a.v ^ s;
+	return r;
+}
+template <> inline Array<u8, 16> operator^(u8 s, Array<u8, 16> a) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = s ^ *(V const *)a.v;
+	return r;
+}
+template <> inline Array<u8, 16> operator~(Array<u8, 16> a) {
+	using V = impl_array::u8x16;
+	Array<u8, 16> r;
+	*(V *)r.v = ~*(V const *)a.v;
+	return r;
+}
+template <> inline Array<i8, 16> operator==(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	using M = impl_array::i8x16;
+	Array<i8, 16> r;
+	*(M *)r.v = *(V const *)a.v == *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i8, 16> operator!=(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	using M = impl_array::i8x16;
+	Array<i8, 16> r;
+	*(M *)r.v = *(V const *)a.v != *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i8, 16> operator>=(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	using M = impl_array::i8x16;
+	Array<i8, 16> r;
+	*(M *)r.v = *(V const *)a.v >= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i8, 16> operator<=(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	using M = impl_array::i8x16;
+	Array<i8, 16> r;
+	*(M *)r.v = *(V const *)a.v <= *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i8, 16> operator>(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	using M = impl_array::i8x16;
+	Array<i8, 16> r;
+	*(M *)r.v = *(V const *)a.v > *(V const *)b.v;
+	return r;
+}
+template <> inline Array<i8, 16> operator<(Array<u8, 16> a, Array<u8, 16> b) {
+	using V = impl_array::u8x16;
+	using M = impl_array::i8x16;
+	Array<i8, 16> r;
+	*(M *)r.v = *(V const *)a.v < *(V const *)b.v;
+	return r;
+}
+template <> inline Array<u8, 16> select(Array<i8, 16> mask, Array<u8, 16> a, Array<u8, 16> b) {
+	using M = impl_array::i8x16;
+	M m = *(M const *)mask.v;
+	Array<u8, 16> r;
+	*(M *)r.v = (m & *(M const *)a.v) | (~m & *(M const *)b.v);
 	return r;
 }
@@ -0,0 +1,502 @@
+#include "base.hpp"
+
+// Structural edits (split/join) never allocate by themselves: leaves they need
+// are allocated up front, and inner nodes are taken from the spare list, which
+// is filled before an edit starts. So an edit either fails before touching the
+// tree or always completes.
+constexpr isize rope_max_spare = 64;
+
+static inline
+bool rope_is_leaf(RopeNode const* n){
+	return n->left == nullptr;
+}
+
+static inline
+byte* rope_leaf_data(RopeNode* n){
+	return (byte*)(n + 1);
+}
+
+static inline
+i32 rope_height(RopeNode const* n){
+	return n ? n->height : -1;
+}
+
+static inline
+bool rope_is_continuation(byte b){
+	return (b & 0xc0) == 0x80;
+}
+
+static
+void rope_count(RopeNode* leaf){
+	byte const* p = rope_leaf_data(leaf);
+	isize runes = 0, lines = 0;
+	for(isize i = 0; i < leaf->bytes; i += 1){
+		runes += !rope_is_continuation(p[i]);
+		lines += p[i] == '\n';
+	}
+	leaf->runes = runes;
+	leaf->lines = lines;
+}
+
+static
+void rope_update(RopeNode* n){
+	n->bytes  = n->left->bytes + n->right->bytes;
+	n->runes  = n->left->runes + n->right->runes;
+	n->lines  = n->left->lines + n->right->lines;
+	n->height = max(n->left->height, n->right->height) + 1;
+}
+
+static
+RopeNode* rope_new_leaf(Rope* r, String text){
+	ensure(len(text) <= rope_leaf_size, "Rope leaf overflow");
+	auto [p, err] = mem_alloc(r->_allocator, isize(sizeof(RopeNode)) + rope_leaf_size, alignof(RopeNode));
+	if(!p){ return nullptr; }
+	auto n = (RopeNode*)p;
+	n->left = nullptr;
+	n->right = nullptr;
+	n->height = 0;
+	n->bytes = len(text);
+	if(len(text) > 0){
+		mem_copy_no_overlap(rope_leaf_data(n), raw_data(text), len(text));
+	}
+	rope_count(n);
+	return n;
+}
+
+static
+void rope_free_leaf(Rope* r, RopeNode* n){
+	mem_free(r->_allocator, n, isize(sizeof(RopeNode)) + rope_leaf_size, alignof(RopeNode));
+}
+
+static
+AllocatorError rope_reserve_inner(Rope* r, isize count){
+	while(r->_spare_count < count){
+		auto n = make<RopeNode>(r->_allocator);
+		if(!n){ return AllocatorError::OutOfMemory; }
+		n->left = r->_spare;
+		r->_spare = n;
+		r->_spare_count += 1;
+	}
+	return {};
+}
+
+static
+RopeNode* rope_take_inner(Rope* r, RopeNode* left, RopeNode* right){
+	ensure(r->_spare != nullptr, "Rope ran out of reserved nodes");
+	RopeNode* n = r->_spare;
+	r->_spare = n->left;
+	r->_spare_count -= 1;
+	n->left = left;
+	n->right = right;
+	rope_update(n);
+	return n;
+}
+
+static
+void rope_give_inner(Rope* r, RopeNode* n){
+	if(r->_spare_count >= rope_max_spare){
+		destroy(n, r->_allocator);
+		return;
+	}
+	n->left = r->_spare;
+	r->_spare = n;
+	r->_spare_count += 1;
+}
+
+static
+void rope_free_tree(Rope* r, RopeNode* n){
+	if(!n){ return; }
+	if(rope_is_leaf(n)){
+		rope_free_leaf(r, n);
+		return;
+	}
+	rope_free_tree(r, n->left);
+	rope_free_tree(r, n->right);
+	rope_give_inner(r, n);
+}
+
+static
+RopeNode* rope_rotate_right(RopeNode* n){
+	RopeNode* l = n->left;
+	n->left = l->right;
+	rope_update(n);
+	l->right = n;
+	rope_update(l);
+	return l;
+}
+
+static
+RopeNode* rope_rotate_left(RopeNode* n){
+	RopeNode* r = n->right;
+	n->right = r->left;
+	rope_update(n);
+	r->left = n;
+	rope_update(r);
+	return r;
+}
+
+static
+RopeNode* rope_rebalance(RopeNode* n){
+	rope_update(n);
+	i32 balance = n->left->height - n->right->height;
+	if(balance > 1){
+		if(rope_height(n->left->left) < rope_height(n->left->right)){
+			n->left = rope_rotate_left(n->left);
+		}
+		return rope_rotate_right(n);
+	}
+	if(balance < -1){
+		if(rope_height(n->right->right) < rope_height(n->right->left)){
+			n->right = rope_rotate_right(n->right);
+		}
+		return rope_rotate_left(n);
+	}
+	return n;
+}
+
+// Concatenate two trees, descending the spine of the taller one so the
+// result stays balanced. Uses at most one spare inner node.
+static
+RopeNode* rope_join(Rope* r, RopeNode* a, RopeNode* b){
+	if(!a){ return b; }
+	if(!b){ return a; }
+
+	if(rope_is_leaf(a) && rope_is_leaf(b) && a->bytes + b->bytes <= rope_leaf_size){
+		mem_copy_no_overlap(rope_leaf_data(a) + a->bytes, rope_leaf_data(b), b->bytes);
+		a->bytes += b->bytes;
+		a->runes += b->runes;
+		a->lines += b->lines;
+		rope_free_leaf(r, b);
+		return a;
+	}
+
+	if(a->height > b->height + 1){
+		a->right = rope_join(r, a->right, b);
+		return rope_rebalance(a);
+	}
+	if(b->height > a->height + 1){
+		b->left = rope_join(r, a, b->left);
+		return rope_rebalance(b);
+	}
+	return rope_take_inner(r, a, b);
+}
+
+// Split into [0, at) and [at, bytes). `spare_leaf` is used (and set to null)
+// when the cut falls inside of a leaf. Inner nodes on the path are recycled
+// through the spare list, which covers the joins done on the way back up.
+static
+Pair<RopeNode*> rope_split_at(Rope* r, RopeNode* n, isize at, RopeNode** spare_leaf){
+	if(!n){ return { nullptr, nullptr }; }
+	if(at <= 0){ return { nullptr, n }; }
+	if(at >= n->bytes){ return { n, nullptr }; }
+
+	if(rope_is_leaf(n)){
+		RopeNode* tail = *spare_leaf;
+		*spare_leaf = nullptr;
+		tail->bytes = n->bytes - at;
+		mem_copy_no_overlap(rope_leaf_data(tail), rope_leaf_data(n) + at, tail->bytes);
+		n->bytes = at;
+		rope_count(n);
+		rope_count(tail);
+		return { n, tail };
+	}
+
+	RopeNode* left = n->left;
+	RopeNode* right = n->right;
+	rope_give_inner(r, n);
+
+	if(at <= left->bytes){
+		auto [a, b] = rope_split_at(r, left, at, spare_leaf);
+		return { a, rope_join(r, b, right) };
+	}
+	auto [a, b] = rope_split_at(r, right, at - left->bytes, spare_leaf);
+	return { rope_join(r, left, a), b };
+}
+
+// Leaf storage for splits, must be released with rope_release_leaf if unused
+static
+RopeNode* rope_spare_leaf(Rope* r){
+	return rope_new_leaf(r, String());
+}
+
+static
+void rope_release_leaf(Rope* r, RopeNode* leaf){
+	if(leaf){ rope_free_leaf(r, leaf); }
+}
+
+// Insert in place when the target leaf has room, keeping the cached counts
+// on the path up to date
+static
+bool rope_insert_in_leaf(RopeNode* n, isize at, String text){
+	if(rope_is_leaf(n)){
+		if(n->bytes + len(text) > rope_leaf_size){ return false; }
+		byte* p = rope_leaf_data(n);
+		mem_copy(p + at + len(text), p + at, n->bytes - at);
+		mem_copy_no_overlap(p + at, raw_data(text), len(text));
+		n->bytes += len(text);
+		rope_count(n);
+		return true;
+	}
+	bool done = at <= n->left->bytes
+		? rope_insert_in_leaf(n->left, at, text)
+		: rope_insert_in_leaf(n->right, at - n->left->bytes, text);
+	if(done){ rope_update(n); }
+	return done;
+}
+
+// Balanced tree of leaves holding `text`, chunks are cut on rune boundaries
+// (so they may come out up to 3 bytes short)
+static
+AllocatorError rope_build(Rope* r, String text, RopeNode** out){
+	isize chunks = (len(text) + rope_leaf_size - 4) / (rope_leaf_size - 3);
+	auto err = rope_reserve_inner(r, chunks);
+	if(!ok(err)){ return err; }
+
+	RopeNode* tree = nullptr;
+	isize start = 0;
+	while(start < len(text)){
+		isize end = min(start + rope_leaf_size, len(text));
+		isize cut = end;
+		while(cut < len(text) && cut > start + 1 && rope_is_continuation(text[cut])){ cut -= 1; }
+		if(cut > start + 1){ end = cut; }
+
+		RopeNode* leaf = rope_new_leaf(r, text[{start, end}]);
+		if(!leaf){
+			rope_free_tree(r, tree);
+			return AllocatorError::OutOfMemory;
+		}
+		tree = rope_join(r, tree, leaf);
+		start = end;
+	}
+	*out = tree;
+	return {};
+}
+
+Rope make_rope(Allocator allocator){
+	Rope r;
+	r._root = nullptr;
+	r._spare = nullptr;
+	r._spare_count = 0;
+	r._allocator = allocator;
+	return r;
+}
+
+void destroy(Rope* r){
+	rope_free_tree(r, r->_root);
+	r->_root = nullptr;
+	while(r->_spare){
+		RopeNode* next = r->_spare->left;
+		destroy(r->_spare, r->_allocator);
+		r->_spare = next;
+	}
+	r->_spare_count = 0;
+}
+
+AllocatorError rope_insert(Rope* r, isize at, String text){
+	bounds_check_assert(at >= 0 && at <= len(*r), "Rope insert position is out of bounds");
+	if(len(text) == 0){ return {}; }
+
+	if(r->_root && rope_insert_in_leaf(r->_root, at, text)){
+		return {};
+	}
+
+	RopeNode* spare = rope_spare_leaf(r);
+	if(!spare){ return AllocatorError::OutOfMemory; }
+
+	RopeNode* mid = nullptr;
+	auto err = rope_build(r, text, &mid);
+	if(!ok(err)){
+		rope_release_leaf(r, spare);
+		return err;
+	}
+	// Two joins put the pieces back together
+	err = rope_reserve_inner(r, 2);
+	if(!ok(err)){
+		rope_free_tree(r, mid);
+		rope_release_leaf(r, spare);
+		return err;
+	}
+
+	auto [head, tail] = rope_split_at(r, r->_root, at, &spare);
+	rope_release_leaf(r, spare);
+	r->_root = rope_join(r, rope_join(r, head, mid), tail);
+	return {};
+}
+
+AllocatorError rope_append(Rope* r, String text){
+	return rope_insert(r, len(*r), text);
+}
+
+AllocatorError rope_remove(Rope* r, isize from, isize to){
+	bounds_check_assert(from >= 0 && from <= to && to <= len(*r), "Rope range is out of bounds");
+	if(from == to){ return {}; }
+
+	auto err = rope_reserve_inner(r, 1);
+	if(!ok(err)){ return err; }
+	RopeNode* spare0 = rope_spare_leaf(r);
+	RopeNode* spare1 = rope_spare_leaf(r);
+	if(!spare0 || !spare1){
+		rope_release_leaf(r, spare0);
+		rope_release_leaf(r, spare1);
+		return AllocatorError::OutOfMemory;
+	}
+
+	auto [head, rest] = rope_split_at(r, r->_root, from, &spare0);
+	auto [mid, tail] = rope_split_at(r, rest, to - from, &spare1);
+	rope_free_tree(r, mid);
+	r->_root = rope_join(r, head, tail);
+
+	rope_release_leaf(r, spare0);
+	rope_release_leaf(r, spare1);
+	return {};
+}
+
+Result<Rope, AllocatorError> rope_split(Rope* r, isize at){
+	bounds_check_assert(at >= 0 && at <= len(*r), "Rope split position is out of bounds");
+	Rope tail = make_rope(r->_allocator);
+
+	RopeNode* spare = rope_spare_leaf(r);
+	if(!spare){ return { tail, AllocatorError::OutOfMemory }; }
+
+	auto [a, b] = rope_split_at(r, r->_root, at, &spare);
+	rope_release_leaf(r, spare);
+	r->_root = a;
+	tail._root = b;
+	return { tail };
+}
+
+AllocatorError rope_concat(Rope* dst, Rope* src){
+	ensure(dst->_allocator.data == src->_allocator.data && dst->_allocator.func == src->_allocator.func,
+		"Concatenated ropes must share an allocator");
+	auto err = rope_reserve_inner(dst, 1);
+	if(!ok(err)){ return err; }
+	dst->_root = rope_join(dst, dst->_root, src->_root);
+	src->_root = nullptr;
+	return {};
+}
+
+byte rope_byte_at(Rope const& r, isize at){
+	bounds_check_assert(at >= 0 && at < len(r), "Rope index is out of bounds");
+	RopeNode* n = r._root;
+	while(!rope_is_leaf(n)){
+		if(at < n->left->bytes){
+			n = n->left;
+		}
+		else {
+			at -= n->left->bytes;
+			n = n->right;
+		}
+	}
+	return rope_leaf_data(n)[at];
+}
+
+String rope_to_string(Rope const& r, isize from, isize to, Allocator allocator){
+	bounds_check_assert(from >= 0 && from <= to && to <= len(r), "Rope range is out of bounds");
+	auto buf = make<byte>(to - from + 1, allocator);
+	[[unlikely]] if(len(buf) == 0){ return ""; }
+
+	isize offset = 0;
+	rope_for_each_chunk(r, from, to, [&](String chunk){
+		mem_copy_no_overlap(raw_data(buf) + offset, raw_data(chunk), len(chunk));
+		offset += len(chunk);
+	});
+	buf[len(buf) - 1] = 0;
+	return String(buf[{0, len(buf) - 1}]);
+}
+
+isize rope_byte_to_rune(Rope const& r, isize at){
+	bounds_check_assert(at >= 0 && at <= len(r), "Rope index is out of bounds");
+	RopeNode* n = r._root;
+	isize runes = 0;
+	if(!n){ return 0; }
+	while(!rope_is_leaf(n)){
+		if(at < n->left->bytes){
+			n = n->left;
+		}
+		else {
+			at -= n->left->bytes;
+			runes += n->left->runes;
+			n = n->right;
+		}
+	}
+	byte const* p = rope_leaf_data(n);
+	for(isize i = 0; i < at; i += 1){
+		runes += !rope_is_continuation(p[i]);
+	}
+	return runes;
+}
+
+isize rope_rune_to_byte(Rope const& r, isize rune){
+	bounds_check_assert(rune >= 0 && rune <= rope_rune_count(r), "Rope rune index is out of bounds");
+	if(rune == rope_rune_count(r)){ return len(r); }
+
+	RopeNode* n = r._root;
+	isize offset = 0;
+	while(!rope_is_leaf(n)){
+		if(rune < n->left->runes){
+			n = n->left;
+		}
+		else {
+			rune -= n->left->runes;
+			offset += n->left->bytes;
+			n = n->right;
+		}
+	}
+	byte const* p = rope_leaf_data(n);
+	for(isize i = 0; i < n->bytes; i += 1){
+		if(!rope_is_continuation(p[i])){
+			if(rune == 0){ return offset + i; }
+			rune -= 1;
+		}
+	}
+	panic("Rope counts are corrupted");
+}
+
+isize rope_byte_to_line(Rope const& r, isize at){
+	bounds_check_assert(at >= 0 && at <= len(r), "Rope index is out of bounds");
+	RopeNode* n = r._root;
+	isize lines = 0;
+	if(!n){ return 0; }
+	while(!rope_is_leaf(n)){
+		if(at < n->left->bytes){
+			n = n->left;
+		}
+		else {
+			at -= n->left->bytes;
+			lines += n->left->lines;
+			n = n->right;
+		}
+	}
+	byte const* p = rope_leaf_data(n);
+	for(isize i = 0; i < at; i += 1){
+		lines += p[i] == '\n';
+	}
+	return lines;
+}
+
+isize rope_line_to_byte(Rope const& r, isize line){
+	bounds_check_assert(line >= 0 && line < rope_line_count(r), "Rope line is out of bounds");
+	if(line == 0){ return 0; }
+
+	// Find the line-th newline, the line starts right after it
+	RopeNode* n = r._root;
+	isize offset = 0;
+	while(!rope_is_leaf(n)){
+		if(line <= n->left->lines){
+			n = n->left;
+		}
+		else {
+			line -= n->left->lines;
+			offset += n->left->bytes;
+			n = n->right;
+		}
+	}
+	byte const* p = rope_leaf_data(n);
+	for(isize i = 0; i < n->bytes; i += 1){
+		if(p[i] == '\n'){
+			line -= 1;
+			if(line == 0){ return offset + i + 1; }
+		}
+	}
+	panic("Rope counts are corrupted");
+}
@@ -0,0 +1,224 @@
+#include "base.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr u64 shared_arena_magic = 0x414e455241524853ull; /* "SHRARENA" */
+
+constexpr isize shared_arena_max_name = 255;
+
+static
+bool shared_arena_cstring_name(char* buf, String name){
+	if(len(name) == 0 || len(name) > shared_arena_max_name){ return false; }
+	mem_copy_no_overlap(buf, raw_data(name), len(name));
+	buf[len(name)] = 0;
+	return true;
+}
+
+static
+SharedArenaError shared_arena_map(SharedArena* a, i32 fd, isize size){
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(p == MAP_FAILED){
+		close(fd);
+		return SharedArenaError::MapFailed;
+	}
+
+	a->header = (SharedArenaHeader*)p;
+	a->mapped_size = size;
+	a->fd = fd;
+	a->last_error = AllocatorError::None;
+	return SharedArenaError::None;
+}
+
+SharedArenaError shared_arena_create_fd(SharedArena* a, i32 fd, isize size){
+	isize header_size = mem_align_forward_size(sizeof(SharedArenaHeader), cache_line_size);
+	if(size <= header_size || ftruncate(fd, size) != 0){
+		close(fd);
+		return SharedArenaError::MapFailed;
+	}
+
+	auto err = shared_arena_map(a, fd, size);
+	if(!ok(err)){ return err; }
+
+	// The magic goes last, openers wait for it before touching anything else
+	auto h = a->header;
+	h->capacity = size;
+	h->offset.store(header_size, std::memory_order_relaxed);
+	h->root.store(0, std::memory_order_relaxed);
+	h->magic.store(shared_arena_magic, std::memory_order_release);
+	return SharedArenaError::None;
+}
+
+SharedArenaError shared_arena_create(SharedArena* a, String name, isize size){
+	char cname[shared_arena_max_name + 1];
+	if(!shared_arena_cstring_name(cname, name)){ return SharedArenaError::BadName; }
+
+	i32 fd = shm_open(cname, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if(fd < 0){ return SharedArenaError::OpenFailed; }
+
+	auto err = shared_arena_create_fd(a, fd, size);
+	if(!ok(err)){
+		shm_unlink(cname);
+	}
+	return err;
+}
+
+// An opener can race the creator between shm_open, ftruncate and the header
+// being written. A size or magic of 0 means creation is still in progress and
+// is polled for a while, anything else that is wrong fails right away.
+constexpr i32 shared_arena_open_attempts = 1000;
+constexpr i32 shared_arena_open_poll_us = 1000;
+
+SharedArenaError shared_arena_open_fd(SharedArena* a, i32 fd){
+	struct stat info;
+	for(i32 attempt = 0;; attempt += 1){
+		if(fstat(fd, &info) != 0){
+			close(fd);
+			return SharedArenaError::BadHeader;
+		}
+		if(info.st_size != 0){ break; }
+		if(attempt == shared_arena_open_attempts){
+			close(fd);
+			return SharedArenaError::BadHeader;
+		}
+		usleep(shared_arena_open_poll_us);
+	}
+	if(isize(info.st_size) <= isize(sizeof(SharedArenaHeader))){
+		close(fd);
+		return SharedArenaError::BadHeader;
+	}
+
+	auto err = shared_arena_map(a, fd, info.st_size);
+	if(!ok(err)){ return err; }
+
+	auto h = a->header;
+	u64 magic = h->magic.load(std::memory_order_acquire);
+	for(i32 attempt = 0; magic == 0 && attempt < shared_arena_open_attempts; attempt += 1){
+		usleep(shared_arena_open_poll_us);
+		magic = h->magic.load(std::memory_order_acquire);
+	}
+
+	if(magic != shared_arena_magic || h->capacity != a->mapped_size){
+		shared_arena_close(a);
+		return SharedArenaError::BadHeader;
+	}
+	return SharedArenaError::None;
+}
+
+SharedArenaError shared_arena_open(SharedArena* a, String name){
+	char cname[shared_arena_max_name + 1];
+	if(!shared_arena_cstring_name(cname, name)){ return SharedArenaError::BadName; }
+
+	i32 fd = shm_open(cname, O_RDWR, 0);
+	if(fd < 0){ return SharedArenaError::OpenFailed; }
+
+	return shared_arena_open_fd(a, fd);
+}
+
+void shared_arena_close(SharedArena* a){
+	if(a->header){
+		munmap((void*)a->header, a->mapped_size);
+	}
+	if(a->fd >= 0){
+		close(a->fd);
+	}
+	a->header = nullptr;
+	a->mapped_size = 0;
+	a->fd = -1;
+}
+
+void shared_arena_unlink(String name){
+	char cname[shared_arena_max_name + 1];
+	if(!shared_arena_cstring_name(cname, name)){ return; }
+	shm_unlink(cname);
+}
+
+void* shared_arena_alloc(SharedArena* a, isize size, isize align){
+	if(size == 0){ return nullptr; }
+	auto h = a->header;
+	uintptr base = (uintptr)h;
+
+	isize offset = h->offset.load(std::memory_order_relaxed);
+	for(;;){
+		uintptr aligned = mem_align_forward_ptr(base + offset, align);
+		isize next = isize(aligned - base) + size;
+		if(next > h->capacity){
+			return nullptr; /* Out of memory */
+		}
+		if(h->offset.compare_exchange_weak(offset, next, std::memory_order_relaxed)){
+			return (void*)aligned;
+		}
+	}
+}
+
+Result<void*, AllocatorError> shared_arena_allocator_func (
+	void* data,
+	AllocatorMode mode,
+	isize new_size,
+	isize new_align,
+	void* old_ptr,
+	isize old_size,
+	isize /* old_align */
+){
+	auto arena = (SharedArena*)data;
+	Result<void*, AllocatorError> result{0};
+
+	using M = AllocatorMode;
+	using C = AllocatorCapability;
+
+	switch(mode){
+	case M::Alloc: {
+		if(!mem_valid_alignment(new_align)){
+			result.error = AllocatorError::BadAlignment;
+			return result;
+		}
+
+		result.value = shared_arena_alloc(arena, new_size, new_align);
+		if(!result.value){
+			result.error = AllocatorError::OutOfMemory;
+		}
+	} break;
+
+	case M::Realloc: {
+		if(!mem_valid_alignment(new_align)){
+			result.error = AllocatorError::BadAlignment;
+			return result;
+		}
+
+		result.value = shared_arena_alloc(arena, new_size, new_align);
+		if(result.value){
+			mem_copy_no_overlap(result.value, old_ptr, min(old_size, new_size));
+		}
+		else {
+			result.error = AllocatorError::OutOfMemory;
+		}
+	} break;
+
+	case M::Free:
+	case M::FreeAll: {
+		result.error = AllocatorError::NotSupported;
+	} break;
+
+	case M::Query: {
+		u32 caps = u32(C::Alloc) | u32(C::Realloc);
+		result.value = (void*)uintptr(caps);
+	} break;
+
+	default: {
+		result.error = AllocatorError::UnknownMode;
+	} break;
+	}
+
+	arena->last_error = result.error;
+	return result;
+}
+
+Allocator shared_arena_allocator(SharedArena* arena){
+	Allocator a = {
+		.data = (void*)arena,
+		.func = shared_arena_allocator_func,
+	};
+	return a;
+}
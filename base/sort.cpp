@@ -0,0 +1,16 @@
+#include "base.hpp"
+
+#define RADIX_SORT_IMPL(T) \
+AllocatorError radix_sort(Slice<T> s, Allocator scratch){ \
+	auto key = [](T v){ return v; }; \
+	return impl_radix::sort(s, scratch, key); \
+}
+
+RADIX_SORT_IMPL(u32)
+RADIX_SORT_IMPL(u64)
+RADIX_SORT_IMPL(i32)
+RADIX_SORT_IMPL(i64)
+RADIX_SORT_IMPL(f32)
+RADIX_SORT_IMPL(f64)
+
+#undef RADIX_SORT_IMPL
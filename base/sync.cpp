@@ -0,0 +1,90 @@
+#include "base.hpp"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert(sizeof(Atomic<u32>) == sizeof(u32), "Futex word must be a plain u32");
+
+void futex_wait(Atomic<u32>* addr, u32 expected){
+	syscall(SYS_futex, (u32*)addr, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+void futex_wake_one(Atomic<u32>* addr){
+	syscall(SYS_futex, (u32*)addr, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+void futex_wake_all(Atomic<u32>* addr){
+	syscall(SYS_futex, (u32*)addr, FUTEX_WAKE_PRIVATE, i32(0x7fffffff), nullptr, nullptr, 0);
+}
+
+struct alignas(cache_line_size) EpochSlot {
+	Atomic<u64>  active; // Epoch the owner entered at, 0 while outside
+	Atomic<bool> claimed;
+};
+
+static EpochSlot epoch_slots[epoch_max_threads];
+static Atomic<isize> epoch_slots_used{0}; // High water mark of claimed slots
+static Atomic<u64> epoch_global{1};
+
+struct EpochSlotOwner {
+	EpochSlot* slot = nullptr;
+	isize depth = 0;
+
+	~EpochSlotOwner(){
+		if(!slot){ return; }
+		slot->active.store(0, std::memory_order_release);
+		slot->claimed.store(false, std::memory_order_release);
+	}
+};
+
+static thread_local EpochSlotOwner epoch_self;
+
+static
+EpochSlot* epoch_claim_slot(){
+	for(isize i = 0; i < epoch_max_threads; i += 1){
+		auto slot = &epoch_slots[i];
+		if(!slot->claimed.load(std::memory_order_relaxed) && !slot->claimed.exchange(true, std::memory_order_acquire)){
+			isize used = epoch_slots_used.load(std::memory_order_relaxed);
+			while(used < i + 1 && !epoch_slots_used.compare_exchange_weak(used, i + 1, std::memory_order_release)){}
+			return slot;
+		}
+	}
+	panic("Too many threads registered for epoch reclamation");
+	return nullptr;
+}
+
+void epoch_enter(){
+	epoch_self.depth += 1;
+	if(epoch_self.depth > 1){ return; }
+	[[unlikely]] if(!epoch_self.slot){
+		epoch_self.slot = epoch_claim_slot();
+	}
+	auto slot = epoch_self.slot;
+	slot->active.store(epoch_global.load(std::memory_order_acquire), std::memory_order_relaxed);
+	// Orders the announcement before any load of shared pointers, pairs with
+	// the fence in epoch_advance
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void epoch_exit(){
+	epoch_self.depth -= 1;
+	if(epoch_self.depth > 0){ return; }
+	epoch_self.slot->active.store(0, std::memory_order_release);
+}
+
+u64 epoch_advance(){
+	u64 tag = epoch_global.fetch_add(1, std::memory_order_acq_rel);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return tag;
+}
+
+u64 epoch_oldest_active(){
+	u64 oldest = ~u64(0);
+	isize used = epoch_slots_used.load(std::memory_order_acquire);
+	for(isize i = 0; i < used; i += 1){
+		u64 e = epoch_slots[i].active.load(std::memory_order_acquire);
+		if(e != 0 && e < oldest){ oldest = e; }
+	}
+	return oldest;
+}
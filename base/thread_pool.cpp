@@ -0,0 +1,106 @@
+#include "base.hpp"
+
+#include <pthread.h>
+
+static
+void thread_pool_run(ThreadPoolTask const& task){
+	task.func(task.data);
+	if(task.group){
+		wait_group_done(task.group);
+	}
+}
+
+static
+void* thread_pool_worker(void* arg){
+	auto pool = (ThreadPool*)arg;
+	for(;;){
+		ThreadPoolTask task;
+		pop(&pool->_queue, &task);
+		if(!task.func){ break; }
+		thread_pool_run(task);
+	}
+	return nullptr;
+}
+
+AllocatorError thread_pool_init(ThreadPool* pool, isize thread_count, Allocator allocator){
+	ensure(thread_count >= 0, "Negative thread count");
+	pool->_allocator = allocator;
+	pool->_thread_count = 0;
+	pool->_threads = nullptr;
+
+	auto err = mpmc_queue_init(&pool->_queue, thread_pool_queue_size, allocator);
+	if(!ok(err)){ return err; }
+
+	if(thread_count == 0){ return {}; }
+
+	auto threads = make<pthread_t>(thread_count, allocator);
+	if(len(threads) == 0){
+		destroy(&pool->_queue);
+		return AllocatorError::OutOfMemory;
+	}
+	pool->_threads = raw_data(threads);
+
+	for(isize i = 0; i < thread_count; i += 1){
+		if(pthread_create(&threads[i], nullptr, thread_pool_worker, pool) != 0){
+			panic("Failed to start thread pool worker");
+		}
+		pool->_thread_count += 1;
+	}
+	return {};
+}
+
+void thread_pool_destroy(ThreadPool* pool){
+	for(isize i = 0; i < pool->_thread_count; i += 1){
+		push(&pool->_queue, ThreadPoolTask{ nullptr, nullptr, nullptr });
+	}
+
+	auto threads = Slice<pthread_t>((pthread_t*)pool->_threads, pool->_thread_count);
+	for(isize i = 0; i < len(threads); i += 1){
+		pthread_join(threads[i], nullptr);
+	}
+	if(pool->_threads){
+		destroy(threads, pool->_allocator);
+	}
+
+	// Tasks still queued are only possible without workers, run them so their groups complete
+	ThreadPoolTask task;
+	while(try_pop(&pool->_queue, &task)){
+		if(task.func){ thread_pool_run(task); }
+	}
+
+	destroy(&pool->_queue);
+	pool->_threads = nullptr;
+	pool->_thread_count = 0;
+}
+
+void thread_pool_submit(ThreadPool* pool, ThreadPoolFunc func, void* data, WaitGroup* group){
+	ensure(func != nullptr, "Thread pool task needs a function");
+	if(group){
+		wait_group_add(group, 1);
+	}
+
+	ThreadPoolTask task = { func, data, group };
+	while(!try_push(&pool->_queue, task)){
+		// Full, make room by running something here instead of blocking (the
+		// workers might be busy, or there might be none at all)
+		ThreadPoolTask other;
+		if(try_pop(&pool->_queue, &other)){
+			thread_pool_run(other);
+		}
+	}
+}
+
+void thread_pool_wait(ThreadPool* pool, WaitGroup* group){
+	for(;;){
+		u32 pending = group->_pending.load(std::memory_order_acquire);
+		if(pending == 0){ return; }
+
+		ThreadPoolTask task;
+		if(try_pop(&pool->_queue, &task)){
+			thread_pool_run(task);
+		}
+		else {
+			futex_wait(&group->_pending, pending);
+		}
+	}
+}
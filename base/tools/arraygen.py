@@ -40,11 +40,28 @@ def arith_bin(op):
 def arith_unary(op):
     return unary_templ.replace('$OP', op).replace('$OUT', 'T')
 
+# Logic operators produce lane masks (all bits set where true), which can be
+# combined with the bitwise operators and fed to select()
+mask_bin_templ = header+'''
+operator$OP($ARR<T,N> a, $ARR<T,N> b){
+  $ARR<$OUT, N> r{};
+  for(int i=0;i<N;i++) r[i] = ArrayMask<T>(-(a[i] $OP b[i]));
+  return r;
+}
+'''
+mask_unary_templ = header+'''
+operator$OP($ARR<T,N> a){
+  $ARR<$OUT, N> r{};
+  for(int i=0;i<N;i++) r[i] = ArrayMask<T>(-$OP a[i]);
+  return r;
+}
+'''
+
 def logic_bin(op):
-    return bin_templ.replace('$OP', op).replace('$OUT', 'bool')
+    return mask_bin_templ.replace('$OP', op).replace('$OUT', 'ArrayMask<T>')
 
 def logic_unary(op):
-    return unary_templ.replace('$OP', op).replace('$OUT', 'bool')
+    return mask_unary_templ.replace('$OP', op).replace('$OUT', 'ArrayMask<T>')
 
 operators = {
     '+': [arith_bin, arith_unary],
@@ -71,13 +88,106 @@ decls = []
 for op, funcs in operators.items():
     decls += [ws.sub(' ', f(op)).strip() for f in funcs]
 
-decls.insert(0, '''template<typename T, int N>
-struct $ARR {
-  T data[N];
-  constexpr T& operator[](int i){ return data[i]; }
-  constexpr T const& operator[](int i) const { return data[i]; }
-};\n
-''')
+# Explicit specializations for shapes that map onto a hardware vector, each
+# operator becomes a single vector instruction instead of a loop through the
+# bounds checked operator[], even without optimizations.
+SIMD_SHAPES = [
+    # (element, lanes, binary operators, unary operators)
+    # 32 byte shapes need AVX to lower to a single instruction
+    ('f32', 4,  ['+', '-', '*', '/'], ['-']),
+    ('f32', 8,  ['+', '-', '*', '/'], ['-']),
+    ('f64', 4,  ['+', '-', '*', '/'], ['-']),
+    ('i32', 4,  ['+', '-', '*', '&', '|', '^'], ['-', '~']),
+    ('i32', 8,  ['+', '-', '*', '&', '|', '^'], ['-', '~']),
+    ('u8',  16, ['+', '-', '&', '|', '^'], ['~']),
+]
+
+SIMD_SIZES = {'f32': 4, 'f64': 8, 'i32': 4, 'i64': 8, 'i8': 1, 'u8': 1}
+
+# Vector comparisons yield signed integer lanes of the same width
+SIMD_MASKS = {'f32': 'i32', 'f64': 'i64', 'i32': 'i32', 'u8': 'i8'}
+
+SIMD_COMPARISONS = ['==', '!=', '>=', '<=', '>', '<']
+
+def vec_name(t, n):
+    return f'{t}x{n}'
+
+simd_bin = '''template <> inline $A operator$OP($A a, $A b) {
+\tusing V = impl_array::$V;
+\t$A r;
+\t*(V *)r.v = *(V const *)a.v $OP *(V const *)b.v;
+\treturn r;
+}
+template <> inline $A operator$OP($A a, $T s) {
+\tusing V = impl_array::$V;
+\t$A r;
+\t*(V *)r.v = *(V const *)a.v $OP s;
+\treturn r;
+}
+template <> inline $A operator$OP($T s, $A a) {
+\tusing V = impl_array::$V;
+\t$A r;
+\t*(V *)r.v = s $OP *(V const *)a.v;
+\treturn r;
+}'''
+
+simd_unary = '''template <> inline $A operator$OP($A a) {
+\tusing V = impl_array::$V;
+\t$A r;
+\t*(V *)r.v = $OP*(V const *)a.v;
+\treturn r;
+}'''
+
+simd_cmp = '''template <> inline $M operator$OP($A a, $A b) {
+\tusing V = impl_array::$V;
+\tusing M = impl_array::$MV;
+\t$M r;
+\t*(M *)r.v = *(V const *)a.v $OP *(V const *)b.v;
+\treturn r;
+}'''
+
+# Bitwise blend, the data is read through the mask's integer vector type
+simd_select = '''template <> inline $A select($M mask, $A a, $A b) {
+\tusing M = impl_array::$MV;
+\tM m = *(M const *)mask.v;
+\t$A r;
+\t*(M *)r.v = (m & *(M const *)a.v) | (~m & *(M const *)b.v);
+\treturn r;
+}'''
+
+def simd_specializations():
+    out = [
+        '// SIMD specializations for common shapes. Loads and stores go through',
+        '// may_alias, element aligned vector types so they work on the plain T[N]',
+        '// inside of Array. The 32 byte shapes (f32x8, i32x8, f64x4) are single',
+        '// instructions only when building with AVX (-mavx2 or a -march that has',
+        '// it), otherwise the compiler splits every operation in two SSE halves.',
+        'namespace impl_array {',
+    ]
+    vec_types = []
+    for t, n, _, _ in SIMD_SHAPES:
+        for et in (t, SIMD_MASKS[t]):
+            if (et, n) not in vec_types:
+                vec_types.append((et, n))
+    for t, n in vec_types:
+        size = SIMD_SIZES[t] * n
+        out.append(f'typedef {t} {vec_name(t, n)} __attribute__((vector_size({size}), aligned({SIMD_SIZES[t]}), may_alias));')
+    out.append('} // namespace impl_array')
+
+    for t, n, bin_ops, unary_ops in SIMD_SHAPES:
+        arr = f'{ARR_TYPE}<{t}, {n}>'
+        mask = f'{ARR_TYPE}<{SIMD_MASKS[t]}, {n}>'
+        def fill(templ, op):
+            return (templ.replace('$A', arr).replace('$T', t).replace('$V', vec_name(t, n))
+                    .replace('$MV', vec_name(SIMD_MASKS[t], n)).replace('$M', mask).replace('$OP', op))
+        out += [fill(simd_bin, op) for op in bin_ops]
+        out += [fill(simd_unary, op) for op in unary_ops]
+        out += [fill(simd_cmp, op) for op in SIMD_COMPARISONS]
+        out.append(fill(simd_select, ''))
+    return '\n'.join(out)
+
+decls.insert(0, '// Auto generated by arraygen.py')
 
 decls = lf.sub('\n', '\n'.join(decls).replace('$ARR', ARR_TYPE))
 print(decls)
+print(simd_specializations())
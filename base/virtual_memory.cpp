@@ -0,0 +1,21 @@
+#include "base.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+isize mem_page_size(){
+	static isize page_size = 0;
+	[[unlikely]] if(page_size == 0){
+		page_size = (isize)sysconf(_SC_PAGESIZE);
+	}
+	return page_size;
+}
+
+void mem_decommit(void* p, isize count){
+	isize page = mem_page_size();
+	uintptr begin = mem_align_forward_ptr((uintptr)p, page);
+	uintptr end   = ((uintptr)p + count) & ~(uintptr(page) - 1);
+	if(end <= begin){ return; }
+
+	madvise((void*)begin, end - begin, MADV_DONTNEED);
+}
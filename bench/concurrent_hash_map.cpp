@@ -0,0 +1,88 @@
+// Read heavy (95% find, 5% insert) throughput of ConcurrentHashMap as the
+// thread count grows.
+//
+// Build from the repository root:
+//   clang++ -std=c++17 -O3 -march=native -I./base -I./deps/mimalloc/include -DUSE_MIMALLOC=1
+//     deps/mimalloc/mimalloc.o base/base.cpp bench/concurrent_hash_map.cpp -lpthread -o bench.exe
+#include "base.hpp"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+constexpr isize key_count = 1 << 20;
+constexpr isize ops_per_thread = 1 << 23;
+
+struct Worker {
+	ConcurrentHashMap<u64, u64>* map;
+	u64 seed;
+	isize hits;
+};
+
+static
+f64 now_seconds(){
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return f64(ts.tv_sec) + f64(ts.tv_nsec) * 1e-9;
+}
+
+static
+void* worker_main(void* data){
+	auto w = (Worker*)data;
+	u64 x = w->seed;
+	isize hits = 0;
+
+	for(isize i = 0; i < ops_per_thread; i += 1){
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		u64 key = x % (key_count * 2);
+
+		if((x >> 40) % 100 < 5){
+			insert(w->map, key, x);
+		}
+		else {
+			u64 v;
+			hits += find(w->map, key, &v);
+		}
+	}
+
+	w->hits = hits;
+	return nullptr;
+}
+
+int main(){
+	auto map = make_concurrent_hash_map<u64, u64>(heap_allocator());
+	defer(destroy(&map));
+
+	for(isize i = 0; i < key_count; i += 1){
+		insert(&map, u64(i) * 2, u64(i));
+	}
+
+	isize cores = sysconf(_SC_NPROCESSORS_ONLN);
+	Worker workers[256];
+	pthread_t threads[256];
+	cores = min(cores, isize(256));
+
+	printf("%8s %14s %10s\n", "threads", "Mops/s", "speedup");
+	f64 base_rate = 0;
+	for(isize n = 1; n <= cores; n = (n * 2 <= cores || n == cores) ? n * 2 : cores){
+		f64 start = now_seconds();
+		for(isize i = 0; i < n; i += 1){
+			workers[i] = { &map, u64(0x9e3779b97f4a7c15ull * (i + 1)), 0 };
+			pthread_create(&threads[i], nullptr, worker_main, &workers[i]);
+		}
+		for(isize i = 0; i < n; i += 1){
+			pthread_join(threads[i], nullptr);
+		}
+		f64 elapsed = now_seconds() - start;
+
+		f64 rate = f64(n * ops_per_thread) / elapsed / 1e6;
+		if(n == 1){ base_rate = rate; }
+		printf("%8ld %14.2f %9.2fx\n", (long)n, rate, rate / base_rate);
+		if(n == cores){ break; }
+	}
+
+	return 0;
+}